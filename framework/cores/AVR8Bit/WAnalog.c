@@ -50,11 +50,9 @@ void analogReference(uint8_t mode)
   analog_reference = mode;
 }
 
-int16_t analogRead(uint8_t pin)
+void analogStart(uint8_t pin)
 {
 #if defined(ADCSRA)
-  uint8_t low, high;
-
   if (adcFirstTime == true)
   {
     adcInit();
@@ -76,9 +74,23 @@ int16_t analogRead(uint8_t pin)
 
   // start the conversion
   ADCSRA |= (1 << ADSC);
+#endif
+}
 
+uint8_t analogDone(void)
+{
+#if defined(ADCSRA)
   // ADSC is cleared when the conversion finishes
-  while (ADCSRA & (1 << ADSC));
+  return !(ADCSRA & (1 << ADSC));
+#else
+  return true;
+#endif
+}
+
+int16_t analogResult(void)
+{
+#if defined(ADCSRA)
+  uint8_t low, high;
 
   // we have to read ADCL first; doing so locks both ADCL
   // and ADCH until ADCH is read.  reading ADCL second would
@@ -94,3 +106,10 @@ int16_t analogRead(uint8_t pin)
   return 0;
 #endif
 }
+
+int16_t analogRead(uint8_t pin)
+{
+  analogStart(pin);
+  while (!analogDone());
+  return analogResult();
+}
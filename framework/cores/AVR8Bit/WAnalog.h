@@ -35,6 +35,14 @@
 int analogRead(uint8_t);
 void analogReference(uint8_t);
 
+// Non blocking conversion: analogStart() selects the channel and starts
+// the ADC, analogDone() returns non zero once the conversion has finished
+// and analogResult() then fetches the value.  analogRead() is the three
+// of them in a row, so do not mix the two on the same ADC.
+void analogStart(uint8_t);
+uint8_t analogDone(void);
+int analogResult(void);
+
 
 #endif
 
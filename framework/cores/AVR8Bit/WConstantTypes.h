@@ -58,6 +58,14 @@ class ConstantString : public Printable
 /* For inline/auto creation of ConstantStrings */
 #define Constant(str) reinterpret_cast<__ConstantStringHelper *>(PSTR(str))
 
+/* For printf() formats in flash, checked against the arguments at
+   compile time:
+     Serial.printf(ConstantFormat("%d samples in %lu ms\n", count, elapsed));
+*/
+int __ConstantFormatCheck(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#define ConstantFormat(fmt, args...) \
+  ((void)sizeof(__ConstantFormatCheck(fmt, ##args)), Constant(fmt)), ##args
+
 /* For global/static creation of ConstantStrings */
 #define ConstantString(name, value) \
   static char __##name[] PROGMEM = value; \
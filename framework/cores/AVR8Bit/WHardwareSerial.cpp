@@ -34,6 +34,7 @@
 
 #if !defined(RXCIE)
 // UCSRnA bits
+#define TXC    6
 #define UDRE   5
 #define U2X    1
 // UCSRnB bits
@@ -47,6 +48,7 @@
 
 /*
 #define RXCIE RXCIE0
+#define TXC   TXC0
 #define UDRIE UDRIE0
 #define RXEN  RXEN0
 #define TXEN  TXEN0
@@ -57,16 +59,72 @@
 */
 #endif
 
+// Receive interrupt, shared by all ports
+
+inline void HardwareSerial::receive(uint8_t c)
+{
+  if (receiveFunction)
+    (*receiveFunction)(c);
+  else if (_frameMode != FRAME_NONE)
+    receiveFrame(c);
+  else
+    rxfifo.enqueue(c);
+}
+
+
+// count is the number of bytes of the frame so far, c the last of them
+inline uint8_t HardwareSerial::frameComplete(uint16_t count, uint8_t c, uint16_t &end)
+{
+  if (_frameMode == FRAME_DELIMITER)
+    return c == _frameValue;
+
+  if (count == _frameValue + 1)
+    end = c + _frameOverhead;
+  return count > _frameValue && count >= end;
+}
+
+
+void HardwareSerial::receiveFrame(uint8_t c)
+{
+  _frameCount++;
+
+  // A frame that does not fit is dropped as a whole, so the FIFO only
+  // ever holds complete frames followed by the one being received.
+  if (!_frameSkip && !rxfifo.enqueue(c))
+  {
+    rxfifo.removeLast(_frameCount - 1);
+    _frameSkip = 1;
+  }
+
+  if (frameComplete(_frameCount, c, _frameEnd))
+  {
+    if (!_frameSkip)
+    {
+      _frames++;
+      if (frameFunction)
+        (*frameFunction)();
+    }
+    _frameSkip = 0;
+    _frameCount = 0;
+    _frameEnd = 0;
+  }
+}
+
+
 #if !defined(SINGLEUSART1)
 ISR(Serial_RX_vect)
 {
-  Serial.rxfifo.enqueue(*Serial._udr);
+  Serial.receive(*Serial._udr);
 }
 
 ISR(Serial_TX_vect)
 {
   if (Serial.txfifo.count() > 0)
+  {
+    // a late interrupt may have let TXC set before this byte
+    *Serial._ucsra = (*Serial._ucsra & (1 << U2X)) | (1 << TXC);
     *Serial._udr = Serial.txfifo.dequeue();
+  }
 
   if (Serial.txfifo.count() == 0)
     *Serial._ucsrb = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
@@ -76,13 +134,17 @@ ISR(Serial_TX_vect)
 #if SERIALPORTS > 1 || defined(SINGLEUSART1)
 ISR(Serial1_RX_vect)
 {
-  Serial1.rxfifo.enqueue(*Serial1._udr);
+  Serial1.receive(*Serial1._udr);
 }
 
 ISR(Serial1_TX_vect)
 {
   if (Serial1.txfifo.count() > 0)
+  {
+    // a late interrupt may have let TXC set before this byte
+    *Serial1._ucsra = (*Serial1._ucsra & (1 << U2X)) | (1 << TXC);
     *Serial1._udr = Serial1.txfifo.dequeue();
+  }
 
   if (Serial1.txfifo.count() == 0)
     *Serial1._ucsrb = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
@@ -92,13 +154,17 @@ ISR(Serial1_TX_vect)
 #if SERIALPORTS > 2
 ISR(Serial2_RX_vect)
 {
-  Serial2.rxfifo.enqueue(*Serial2._udr);
+  Serial2.receive(*Serial2._udr);
 }
 
 ISR(Serial2_TX_vect)
 {
   if (Serial2.txfifo.count() > 0)
+  {
+    // a late interrupt may have let TXC set before this byte
+    *Serial2._ucsra = (*Serial2._ucsra & (1 << U2X)) | (1 << TXC);
     *Serial2._udr = Serial2.txfifo.dequeue();
+  }
 
   if (Serial2.txfifo.count() == 0)
     *Serial2._ucsrb = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
@@ -108,13 +174,17 @@ ISR(Serial2_TX_vect)
 #if SERIALPORTS > 3
 ISR(Serial3_RX_vect)
 {
-  Serial3.rxfifo.enqueue(*Serial3._udr);
+  Serial3.receive(*Serial3._udr);
 }
 
 ISR(Serial3_TX_vect)
 {
   if (Serial3.txfifo.count() > 0)
+  {
+    // a late interrupt may have let TXC set before this byte
+    *Serial3._ucsra = (*Serial3._ucsra & (1 << U2X)) | (1 << TXC);
     *Serial3._udr = Serial3.txfifo.dequeue();
+  }
 
   if (Serial3.txfifo.count() == 0)
     *Serial3._ucsrb = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
@@ -126,6 +196,12 @@ ISR(Serial3_TX_vect)
 
 HardwareSerial::HardwareSerial(uint8_t serialPortNumber)
 {
+  _transmitting = 0;
+  receiveFunction = NULL;
+  _frameMode = FRAME_NONE;
+  frameFunction = NULL;
+  flush();
+
   switch (serialPortNumber)
   {
     // We do not take into consideration older AVRs with a single UART,
@@ -310,7 +386,16 @@ int HardwareSerial::peek(void)
 
 void HardwareSerial::flush()
 {
+  uint8_t oldSREG = SREG;
+  cli();
+
   rxfifo.flush();
+  _frames = 0;
+  _frameCount = 0;
+  _frameEnd = 0;
+  _frameSkip = 0;
+
+  SREG = oldSREG;
 }
 
 
@@ -323,9 +408,154 @@ void HardwareSerial::write(uint8_t c)
   cli();
 
   txfifo.enqueue(c);
-  *_ucsrb |= (1 << UDRIE);
+  startTransmit();
+
+  SREG = oldSREG;
+}
+
+
+void HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  while (size)
+  {
+    // We will block here until we have some space free in the FIFO
+    while (txfifo.count() >= TX_BUFFER_SIZE);
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    // then queue as much as fits in one go
+    while (size && txfifo.enqueue(*buffer))
+    {
+      buffer++;
+      size--;
+    }
+    startTransmit();
+
+    SREG = oldSREG;
+  }
+}
+
+
+int HardwareSerial::availableForWrite(void)
+{
+  return TX_BUFFER_SIZE - txfifo.count();
+}
+
+
+// True until the last byte written has completely left the shift
+// register, e.g. to know when to release an RS-485 driver.
+uint8_t HardwareSerial::transmitting(void)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  if (_transmitting && txfifo.count() == 0 &&
+      !(*_ucsrb & (1 << UDRIE)) && (*_ucsra & (1 << TXC)))
+    _transmitting = 0;
 
   SREG = oldSREG;
+
+  return _transmitting;
+}
+
+
+void HardwareSerial::attachInterrupt(void (*userFunc)(uint8_t))
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  receiveFunction = userFunc;
+
+  SREG = oldSREG;
+}
+
+
+// Split the received bytes into frames, in the receive interrupt.
+// FRAME_DELIMITER: a frame ends with the byte value, e.g. '\n'.
+// FRAME_LENGTH: the byte at offset value (counted from 0) holds the
+// length, the whole frame is that plus overhead bytes.
+// FRAME_NONE turns it off.  Anything received so far is dropped.
+void HardwareSerial::setFraming(uint8_t mode, uint8_t value, uint8_t overhead)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  _frameMode = mode;
+  _frameValue = value;
+  _frameOverhead = overhead;
+  flush();
+
+  SREG = oldSREG;
+}
+
+
+int HardwareSerial::availableFrames(void)
+{
+  uint16_t frames;
+  uint8_t oldSREG = SREG;
+  cli();
+
+  frames = _frames;
+
+  SREG = oldSREG;
+
+  return frames;
+}
+
+
+// Copy the next frame, the delimiter included, into buffer.  A frame
+// longer than size is cut short.  Frames do not mix with read().
+// Returns the length of the frame, or -1 if there is none.
+int HardwareSerial::readFrame(uint8_t *buffer, size_t size)
+{
+  uint16_t length = 0;
+  uint16_t end = 0;
+  uint8_t c;
+
+  if (availableFrames() == 0)
+    return -1;
+
+  do
+  {
+    c = read();
+    if (length < size)
+      buffer[length] = c;
+    length++;
+  }
+  while (!frameComplete(length, c, end));
+
+  uint8_t oldSREG = SREG;
+  cli();
+
+  _frames--;
+
+  SREG = oldSREG;
+
+  return length;
+}
+
+
+void HardwareSerial::attachFrameInterrupt(void (*userFunc)(void))
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  frameFunction = userFunc;
+
+  SREG = oldSREG;
+}
+
+
+// Private Methods
+
+// Called with interrupts off, after queueing
+void HardwareSerial::startTransmit(void)
+{
+  // TXC is cleared by writing a one, the error flags have to be written as zero
+  *_ucsra = (*_ucsra & (1 << U2X)) | (1 << TXC);
+  _transmitting = 1;
+  *_ucsrb |= (1 << UDRIE);
 }
 
 
@@ -26,9 +26,17 @@
 #include <Stream.h>
 #include <FIFO.h>
 
+// also the longest frame that setFraming() can deliver
+#ifndef RX_BUFFER_SIZE
 #define RX_BUFFER_SIZE 32
+#endif
 #define TX_BUFFER_SIZE 16
 
+// receive framing modes
+#define FRAME_NONE      0
+#define FRAME_DELIMITER 1
+#define FRAME_LENGTH    2
+
 #define SERIALPORTS 0
 
 #if defined(USART0_RX_vect)
@@ -125,6 +133,21 @@ class HardwareSerial : public Stream
     volatile uint8_t *_ucsrb;
     volatile uint8_t *_ucsrc;
     volatile uint8_t *_udr;
+    volatile uint8_t _transmitting;
+    void (*receiveFunction)(uint8_t);
+    // receive framing
+    uint8_t _frameMode;
+    uint8_t _frameValue;        // the delimiter, or the offset of the length byte
+    uint8_t _frameOverhead;     // bytes of the frame not counted by the length byte
+    uint8_t _frameSkip;         // the frame being received did not fit
+    uint16_t _frameCount;       // bytes of the frame being received
+    uint16_t _frameEnd;         // its length, once the length byte is in
+    volatile uint16_t _frames;  // complete frames in rxfifo
+    void (*frameFunction)(void);
+    inline void receive(uint8_t c);
+    void receiveFrame(uint8_t c);
+    inline uint8_t frameComplete(uint16_t count, uint8_t c, uint16_t &end);
+    void startTransmit(void);
   public:
     HardwareSerial(uint8_t SerialPortNumber);
     void begin(const uint32_t baud = 9600,
@@ -137,6 +160,19 @@ class HardwareSerial : public Stream
     int peek(void);
     void flush(void);
     void write(uint8_t);
+    void write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str)
+    int availableForWrite(void);
+    uint8_t transmitting(void);
+    // hand received bytes to userFunc from the interrupt, instead of the FIFO
+    void attachInterrupt(void (*userFunc)(uint8_t));
+    inline void detachInterrupt(void) { attachInterrupt(NULL); };
+    void setFraming(uint8_t mode, uint8_t value = 0, uint8_t overhead = 0);
+    int availableFrames(void);
+    int readFrame(uint8_t *buffer, size_t size);
+    // call userFunc from the interrupt whenever a frame is complete
+    void attachFrameInterrupt(void (*userFunc)(void));
+    inline void detachFrameInterrupt(void) { attachFrameInterrupt(NULL); };
 };
 
 #if !defined(SINGLEUSART1)
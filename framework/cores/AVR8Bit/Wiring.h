@@ -166,6 +166,8 @@ static inline void noPullup(uint8_t PIN) { pinWrite(PIN, LOW); }
 #ifdef __cplusplus
 #include "WVector.h"
 #include "WString.h"
+#include "StringBuilder.h"
+#include "Tokenizer.h"
 #include "WCharacter.h"
 //#include "WMemory.h"
 #include "WShift.h"
@@ -27,20 +27,25 @@ extern "C" {
 //* Support Functions
 //******************************************************************************
 
-void sendValueAsTwo7bitBytes(int value)
+// number of data bytes that follow each channel command, indexed by
+// its high nibble (0x80-0xE0), so unknown ones are skipped correctly
+static const byte channelMessageLength[7] = {
+  2, // 0x80 note off
+  2, // 0x90 DIGITAL_MESSAGE
+  2, // 0xA0 aftertouch
+  2, // 0xB0 control change
+  1, // 0xC0 REPORT_ANALOG
+  1, // 0xD0 REPORT_DIGITAL
+  2  // 0xE0 ANALOG_MESSAGE
+};
+
+// store a command byte and a 14 bit value as one 3 byte message
+static byte *packMessage(byte *buffer, byte command, int value)
 {
-  Serial.print(value & B01111111, BYTE); // LSB
-  Serial.print(value >> 7 & B01111111, BYTE); // MSB
-}
-
-void startSysex(void)
-{
-  Serial.print(START_SYSEX, BYTE);
-}
-
-void endSysex(void)
-{
-  Serial.print(END_SYSEX, BYTE);
+  *buffer++ = command;
+  *buffer++ = value & B01111111; // LSB
+  *buffer++ = value >> 7 & B01111111; // MSB
+  return buffer;
 }
 
 //******************************************************************************
@@ -49,7 +54,26 @@ void endSysex(void)
 
 FirmataClass::FirmataClass(void)
 {
+  byte i;
+
+  FirmataStream = &Serial;
   firmwareVersionCount = 0;
+  for(i=0; i<7; i++) {
+    channelCallback[i] = NULL;
+  }
+  currentPinModeCallback = NULL;
+  currentSystemResetCallback = NULL;
+  currentStringCallback = NULL;
+  currentSysexCallback = NULL;
+  samplingInterval = DEFAULT_SAMPLING_INTERVAL;
+  previousMillis = 0;
+  analogChannel = 0xFF;
+  for(i=0; i<TOTAL_ANALOG_PINS; i++) {
+    analogThreshold[i] = 0;
+  }
+  for(i=0; i<TOTAL_PORTS; i++) {
+    portInputMask[i] = 0;
+  }
   systemReset();
 }
 
@@ -67,17 +91,26 @@ void FirmataClass::begin(void)
 void FirmataClass::begin(long speed)
 {
   Serial.begin(speed);
+  FirmataStream = &Serial;
   blinkVersion();
   delay(300);
   printVersion();
   printFirmwareVersion();
 }
 
+/* begin method for any other Stream, which must already be set up */
+void FirmataClass::begin(Stream &stream)
+{
+  FirmataStream = &stream;
+  printVersion();
+  printFirmwareVersion();
+}
+
 // output the protocol version message to the serial port
 void FirmataClass::printVersion(void) {
-  Serial.print(REPORT_VERSION, BYTE);
-  Serial.print(FIRMATA_MAJOR_VERSION, BYTE);
-  Serial.print(FIRMATA_MINOR_VERSION, BYTE);
+  byte message[3] = { REPORT_VERSION, FIRMATA_MAJOR_VERSION, FIRMATA_MINOR_VERSION };
+
+  FirmataStream->write(message, 3);
 }
 
 void FirmataClass::blinkVersion(void)
@@ -97,9 +130,9 @@ void FirmataClass::printFirmwareVersion(void)
 
   if(firmwareVersionCount) { // make sure that the name has been set before reporting
     startSysex();
-    Serial.print(REPORT_FIRMWARE, BYTE);
-    Serial.print(firmwareVersionVector[0]); // major version number
-    Serial.print(firmwareVersionVector[1]); // minor version number
+    FirmataStream->write(REPORT_FIRMWARE);
+    FirmataStream->write(firmwareVersionVector[0]); // major version number
+    FirmataStream->write(firmwareVersionVector[1]); // minor version number
     for(i=2; i<firmwareVersionCount; ++i) {
       sendValueAsTwo7bitBytes(firmwareVersionVector[i]);
     }
@@ -137,7 +170,7 @@ void FirmataClass::setFirmwareNameAndVersion(const char *name, byte major, byte
 
 int FirmataClass::available(void)
 {
-  return Serial.available();
+  return FirmataStream->available();
 }
 
 
@@ -147,113 +180,116 @@ void FirmataClass::processSysexMessage(void)
   case REPORT_FIRMWARE:
     printFirmwareVersion();
     break;
+  case SAMPLING_INTERVAL:
+    if(dataBytesRead > 2)
+      setSamplingInterval(storedInputData[1] + (storedInputData[2] << 7));
+    // sketches that keep their own timing still get to see it
+    if(currentSysexCallback)
+      (*currentSysexCallback)(storedInputData[0], dataBytesRead - 1, storedInputData + 1);
+    break;
   case STRING_DATA:
     if(currentStringCallback) {
-      byte bufferLength = (sysexBytesRead - 1) / 2;
-      char *buffer = (char*)malloc(bufferLength * sizeof(char));
+      // decode in place, the string is always shorter than its encoding
+      byte bufferLength = (dataBytesRead - 1) / 2;
+      char *buffer = (char*)storedInputData;
       byte i = 1;
       byte j = 0;
       while(j < bufferLength) {
-        buffer[j] = (char)storedInputData[i];
-        i++;
-        buffer[j] += (char)(storedInputData[i] << 7);
-        i++;
+        buffer[j] = (char)(storedInputData[i] + (storedInputData[i + 1] << 7));
+        i += 2;
         j++;
       }
+      buffer[j] = 0;
       (*currentStringCallback)(buffer);
     }
     break;
   default:
     if(currentSysexCallback)
-      (*currentSysexCallback)(storedInputData[0], sysexBytesRead - 1, storedInputData + 1);
+      (*currentSysexCallback)(storedInputData[0], dataBytesRead - 1, storedInputData + 1);
   }
 }
 
+void FirmataClass::processMultiByteMessage(void)
+{
+  if(executeMultiByteCommand == SET_PIN_MODE) {
+    if(currentPinModeCallback)
+      (*currentPinModeCallback)(storedInputData[0], storedInputData[1]);
+  } else {
+    callbackFunction callback = channelCallback[(executeMultiByteCommand >> 4) - 8];
+    if(callback) {
+      int value = storedInputData[0];
+      if(dataBytesRead > 1)
+        value += storedInputData[1] << 7;
+      (*callback)(multiByteChannel, value);
+    }
+  }
+}
+
+/* Parse everything that is waiting on the stream in one go.  Bytes that
+ * arrive while the callbacks run are left for the next call. */
 void FirmataClass::processInput(void)
 {
-  int inputData = Serial.read(); // this is 'int' to handle -1 when no data
-  int command;
-    
-  // TODO make sure it handles -1 properly
+  int count = FirmataStream->available();
 
-  if (parsingSysex) {
-    if(inputData == END_SYSEX) {
-      //stop sysex byte      
-      parsingSysex = false;
-      //fire off handler function
-      processSysexMessage();
-    } else {
-      //normal data byte - add to buffer
-      storedInputData[sysexBytesRead] = inputData;
-      sysexBytesRead++;
-    }
-  } else if( (waitForData > 0) && (inputData < 128) ) {  
-    waitForData--;
-    storedInputData[waitForData] = inputData;
-    if( (waitForData==0) && executeMultiByteCommand ) { // got the whole message
-      switch(executeMultiByteCommand) {
-      case ANALOG_MESSAGE:
-        if(currentAnalogCallback) {
-          (*currentAnalogCallback)(multiByteChannel,
-                                   (storedInputData[0] << 7)
-                                   + storedInputData[1]);
-        }
-        break;
-      case DIGITAL_MESSAGE:
-        if(currentDigitalCallback) {
-          (*currentDigitalCallback)(multiByteChannel,
-                                    (storedInputData[0] << 7)
-                                    + storedInputData[1]);
-        }
-        break;
-      case SET_PIN_MODE:
-        if(currentPinModeCallback)
-          (*currentPinModeCallback)(storedInputData[1], storedInputData[0]);
-        break;
-      case REPORT_ANALOG:
-        if(currentReportAnalogCallback)
-          (*currentReportAnalogCallback)(multiByteChannel,storedInputData[0]);
-        break;
-      case REPORT_DIGITAL:
-        if(currentReportDigitalCallback)
-          (*currentReportDigitalCallback)(multiByteChannel,storedInputData[0]);
-        break;
-      }
-      executeMultiByteCommand = 0;
-    }	
-  } else {
-    // remove channel info from command byte if less than 0xF0
-    if(inputData < 0xF0) {
-      command = inputData & 0xF0;
-      multiByteChannel = inputData & 0x0F;
-    } else {
-      command = inputData;
-      // commands in the 0xF* range don't use channel data
+  while(count-- > 0)
+    parse(FirmataStream->read());
+}
+
+void FirmataClass::parse(byte inputData)
+{
+  if(inputData < 0x80) {
+    // data byte, for a sysex or a multi byte message (or stray)
+    if(parsingSysex) {
+      if(dataBytesRead < MAX_DATA_BYTES)
+        storedInputData[dataBytesRead++] = inputData;
+      else
+        sysexOverflow = true;
+    } else if(waitForData) {
+      storedInputData[dataBytesRead++] = inputData;
+      if(--waitForData == 0)
+        processMultiByteMessage();
     }
-    switch (command) {
-    case ANALOG_MESSAGE:
-    case DIGITAL_MESSAGE:
-    case SET_PIN_MODE:
-      waitForData = 2; // two data bytes needed
-      executeMultiByteCommand = command;
-      break;
-    case REPORT_ANALOG:
-    case REPORT_DIGITAL:
-      waitForData = 1; // two data bytes needed
-      executeMultiByteCommand = command;
-      break;
-    case START_SYSEX:
-      parsingSysex = true;
-      sysexBytesRead = 0;
-      break;
-    case SYSTEM_RESET:
-      systemReset();
-      break;
-    case REPORT_VERSION:
-      Firmata.printVersion();
-      break;
+    return;
+  }
+
+  // any command byte ends the message that was being received
+  waitForData = 0;
+  if(parsingSysex) {
+    parsingSysex = false;
+    if(inputData == END_SYSEX) {
+      // a sysex that did not fit is dropped rather than truncated
+      if(!sysexOverflow && dataBytesRead > 0)
+        processSysexMessage();
+      return;
     }
   }
+  dataBytesRead = 0;
+
+  if(inputData < 0xF0) {
+    // channel commands carry the channel (pin or port) in the low nibble
+    executeMultiByteCommand = inputData & 0xF0;
+    multiByteChannel = inputData & 0x0F;
+    waitForData = channelMessageLength[(inputData >> 4) - 8];
+    return;
+  }
+
+  // commands in the 0xF* range don't use channel data
+  switch(inputData) {
+  case SET_PIN_MODE:
+    executeMultiByteCommand = SET_PIN_MODE;
+    waitForData = 2; // pin and mode
+    break;
+  case START_SYSEX:
+    parsingSysex = true;
+    sysexOverflow = false;
+    break;
+  case SYSTEM_RESET:
+    systemReset();
+    break;
+  case REPORT_VERSION:
+    printVersion();
+    break;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -262,9 +298,11 @@ void FirmataClass::processInput(void)
 // send an analog message
 void FirmataClass::sendAnalog(byte pin, int value) 
 {
+  byte message[3];
+
   // pin can only be 0-15, so chop higher bits
-  Serial.print(ANALOG_MESSAGE | (pin & 0xF), BYTE);
-  sendValueAsTwo7bitBytes(value);
+  packMessage(message, ANALOG_MESSAGE | (pin & 0xF), value);
+  FirmataStream->write(message, 3);
 }
 
 // send a single digital pin in a digital message
@@ -294,9 +332,10 @@ void FirmataClass::sendDigital(byte pin, int value)
 // send an 8-bit port in a single digital message (protocol v2)
 void FirmataClass::sendDigitalPort(byte portNumber, int portData)
 {
-  Serial.print(DIGITAL_MESSAGE | (portNumber & 0xF),BYTE);
-  Serial.print((byte)portData % 128, BYTE); // Tx bits 0-6
-  Serial.print(portData >> 7, BYTE);  // Tx bits 7-13
+  byte message[3];
+
+  packMessage(message, DIGITAL_MESSAGE | (portNumber & 0xF), portData);
+  FirmataStream->write(message, 3);
 }
 
 
@@ -304,7 +343,7 @@ void FirmataClass::sendSysex(byte command, byte bytec, byte* bytev)
 {
   byte i;
   startSysex();
-  Serial.print(command, BYTE);
+  FirmataStream->write(command);
   for(i=0; i<bytec; i++) {
     sendValueAsTwo7bitBytes(bytev[i]);        
   }
@@ -324,18 +363,148 @@ void FirmataClass::sendString(const char* string)
 }
 
 
+//------------------------------------------------------------------------------
+// Sampling Engine
+
+/* Digital ports are read on every call and sent only when one of their
+ * input bits changed.  Analog inputs are converted in the background by
+ * serviceAnalog() and sent once per sampling interval, but only if they
+ * moved by more than their threshold.  Everything that has to go out in
+ * one call is packed into a single buffer and written in one go. */
+void FirmataClass::sample(void)
+{
+  byte packet[3 * (TOTAL_PORTS + TOTAL_ANALOG_PINS)];
+  byte *p = packet;
+  byte i;
+
+  serviceAnalog();
+
+  for(i=0; i<TOTAL_PORTS; i++) {
+    if(portsToReport & (1 << i)) {
+      byte value = readPort(i, portInputMask[i]);
+      if(value != portSent[i] || (portsToForce & (1 << i))) {
+        p = packMessage(p, DIGITAL_MESSAGE | i, value);
+        portSent[i] = value;
+      }
+    }
+  }
+  portsToForce = 0;
+
+  if(millis() - previousMillis >= samplingInterval) {
+    previousMillis += samplingInterval;
+    // after a stall, drop the missed intervals instead of catching up
+    if(millis() - previousMillis >= samplingInterval)
+      previousMillis = millis();
+
+    for(i=0; i<TOTAL_ANALOG_PINS; i++) {
+      uint16_t bit = 1 << i;
+      if(analogInputsToReport & analogInputsSampled & bit) {
+        int change = analogValue[i] - analogSent[i];
+        if(change < 0)
+          change = -change;
+        if(change > analogThreshold[i] || (analogInputsToForce & bit)) {
+          p = packMessage(p, ANALOG_MESSAGE | (i & 0xF), analogValue[i]);
+          analogSent[i] = analogValue[i];
+          analogInputsToForce &= ~bit;
+        }
+      }
+    }
+  }
+
+  if(p != packet)
+    FirmataStream->write(packet, p - packet);
+}
+
+/* Keep the ADC busy with the reported channels, round robin.  A finished
+ * conversion is picked up and the next one started, so the interval tick
+ * in sample() only ever looks at results that are already there. */
+void FirmataClass::serviceAnalog(void)
+{
+#if TOTAL_ANALOG_PINS > 0
+  byte i = analogChannel;
+
+  if(analogChannel != 0xFF) {
+    if(!analogDone())
+      return;
+    analogValue[analogChannel] = analogResult();
+    analogInputsSampled |= 1 << analogChannel;
+  }
+
+  analogChannel = 0xFF;
+  if(analogInputsToReport) {
+    do {
+      i = (i + 1) % TOTAL_ANALOG_PINS;
+    } while(!(analogInputsToReport & (1 << i)));
+    analogStart(i);
+    analogChannel = i;
+  }
+#endif
+}
+
+void FirmataClass::setSamplingInterval(unsigned int interval)
+{
+  samplingInterval = interval;
+}
+
+unsigned int FirmataClass::getSamplingInterval(void)
+{
+  return samplingInterval;
+}
+
+// the first reading after reporting is enabled is always sent
+void FirmataClass::reportAnalog(byte analogPin, boolean enable)
+{
+  if(analogPin < TOTAL_ANALOG_PINS) {
+    uint16_t bit = 1 << analogPin;
+    analogInputsSampled &= ~bit;
+    if(enable) {
+      analogInputsToReport |= bit;
+      analogInputsToForce |= bit;
+    } else {
+      analogInputsToReport &= ~bit;
+      analogInputsToForce &= ~bit;
+    }
+  }
+}
+
+// only send an analog pin when it moved by more than threshold (0 = any change)
+void FirmataClass::setAnalogThreshold(byte analogPin, byte threshold)
+{
+  if(analogPin < TOTAL_ANALOG_PINS)
+    analogThreshold[analogPin] = threshold;
+}
+
+// the current state of the port is always sent when reporting is enabled
+void FirmataClass::reportDigital(byte portNumber, boolean enable)
+{
+  if(portNumber < TOTAL_PORTS) {
+    uint16_t bit = 1 << portNumber;
+    if(enable) {
+      portsToReport |= bit;
+      portsToForce |= bit;
+    } else {
+      portsToReport &= ~bit;
+    }
+  }
+}
+
+// bit n set = pin n of the port is an input and gets reported
+void FirmataClass::setDigitalInputMask(byte portNumber, byte mask)
+{
+  if(portNumber < TOTAL_PORTS)
+    portInputMask[portNumber] = mask;
+}
+
+
 // Internal Actions/////////////////////////////////////////////////////////////
 
 // generic callbacks
 void FirmataClass::attach(byte command, callbackFunction newFunction)
 {
-  switch(command) {
-  case ANALOG_MESSAGE: currentAnalogCallback = newFunction; break;
-  case DIGITAL_MESSAGE: currentDigitalCallback = newFunction; break;
-  case REPORT_ANALOG: currentReportAnalogCallback = newFunction; break;
-  case REPORT_DIGITAL: currentReportDigitalCallback = newFunction; break;
-  case SET_PIN_MODE: currentPinModeCallback = newFunction; break;
-  }
+  if(command == SET_PIN_MODE)
+    currentPinModeCallback = newFunction;
+  else if(command >= 0x80 && command < 0xF0)
+    channelCallback[(command >> 4) - 8] = newFunction;
 }
 
 void FirmataClass::attach(byte command, systemResetCallbackFunction newFunction)
@@ -390,6 +559,22 @@ void FirmataClass::detach(byte command)
 //* Private Methods
 //******************************************************************************
 
+void FirmataClass::sendValueAsTwo7bitBytes(int value)
+{
+  FirmataStream->write(value & B01111111); // LSB
+  FirmataStream->write(value >> 7 & B01111111); // MSB
+}
+
+void FirmataClass::startSysex(void)
+{
+  FirmataStream->write(START_SYSEX);
+}
+
+void FirmataClass::endSysex(void)
+{
+  FirmataStream->write(END_SYSEX);
+}
+
 
 
 // resets the system state upon a SYSTEM_RESET message from the host software
@@ -400,6 +585,7 @@ void FirmataClass::systemReset(void)
   waitForData = 0; // this flag says the next serial input will be data
   executeMultiByteCommand = 0; // execute this after getting multi-byte data
   multiByteChannel = 0; // channel data for multiByteCommands
+  dataBytesRead = 0;
 
 
   for(i=0; i<MAX_DATA_BYTES; i++) {
@@ -407,7 +593,13 @@ void FirmataClass::systemReset(void)
   }
 
   parsingSysex = false;
-  sysexBytesRead = 0;
+  sysexOverflow = false;
+
+  analogInputsToReport = 0;
+  analogInputsToForce = 0;
+  analogInputsSampled = 0;
+  portsToReport = 0;
+  portsToForce = 0;
 
   if(currentSystemResetCallback)
     (*currentSystemResetCallback)();
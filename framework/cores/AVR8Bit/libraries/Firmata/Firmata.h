@@ -25,7 +25,9 @@
 #define FIRMATA_MINOR_VERSION   2 // for backwards compatible changes
 #define FIRMATA_BUGFIX_VERSION  1 // for bugfix releases
 
-#define MAX_DATA_BYTES 32 // max number of data bytes in non-Sysex messages
+#ifndef MAX_DATA_BYTES
+#define MAX_DATA_BYTES 32 // max number of data bytes in incoming messages
+#endif
 
 // message command bytes (128-255/0x80-0xFF)
 #define DIGITAL_MESSAGE         0x90 // send data for a digital pin
@@ -76,6 +78,12 @@
 #define I2C                     0x06 // pin included in I2C setup
 #define TOTAL_PIN_MODES         7
 
+// default period of the sampling engine (in ms)
+#define DEFAULT_SAMPLING_INTERVAL 19
+
+/* Hardware Abstraction Layer */
+#include "Boards.h"
+
 extern "C" {
 // callback function types
     typedef void (*callbackFunction)(byte, int);
@@ -85,7 +93,6 @@ extern "C" {
 }
 
 
-// TODO make it a subclass of a generic Serial/Stream base class
 class FirmataClass
 {
 public:
@@ -93,6 +100,7 @@ public:
 /* Arduino constructors */
     void begin();
     void begin(long);
+    void begin(Stream &stream); // talk over an already started Stream
 /* querying functions */
 	void printVersion(void);
     void blinkVersion(void);
@@ -101,7 +109,8 @@ public:
     void setFirmwareNameAndVersion(const char *name, byte major, byte minor);
 /* serial receive handling */
     int available(void);
-    void processInput(void);
+    void processInput(void); // parse everything available on the stream
+    void parse(byte inputData);
 /* serial send handling */
 	void sendAnalog(byte pin, int value);
 	void sendDigital(byte pin, int value); // TODO implement this
@@ -115,31 +124,57 @@ public:
     void attach(byte command, stringCallbackFunction newFunction);
     void attach(byte command, sysexCallbackFunction newFunction);
     void detach(byte command);
+/* sampling engine, call sample() on every pass of loop() */
+    void sample(void);
+    void setSamplingInterval(unsigned int interval);
+    unsigned int getSamplingInterval(void);
+    void reportAnalog(byte analogPin, boolean enable);
+    void setAnalogThreshold(byte analogPin, byte threshold);
+    void reportDigital(byte portNumber, boolean enable);
+    void setDigitalInputMask(byte portNumber, byte mask);
 
 private:
+    Stream *FirmataStream;
 /* firmware name and version */
     byte firmwareVersionCount;
     byte *firmwareVersionVector;
 /* input message handling */
-    byte waitForData; // this flag says the next serial input will be data
+    byte waitForData; // data bytes still missing from the current message
     byte executeMultiByteCommand; // execute this after getting multi-byte data
     byte multiByteChannel; // channel data for multiByteCommands
-    byte storedInputData[MAX_DATA_BYTES]; // multi-byte data
+    byte dataBytesRead; // bytes in storedInputData
+    byte storedInputData[MAX_DATA_BYTES]; // multi-byte and sysex data
 /* sysex */
     boolean parsingSysex;
-    int sysexBytesRead;
+    boolean sysexOverflow; // too long for storedInputData, will be dropped
 /* callback functions */
-    callbackFunction currentAnalogCallback;
-    callbackFunction currentDigitalCallback;
-    callbackFunction currentReportAnalogCallback;
-    callbackFunction currentReportDigitalCallback;
+    callbackFunction channelCallback[7]; // indexed by command nibble 0x8-0xE
     callbackFunction currentPinModeCallback;
     systemResetCallbackFunction currentSystemResetCallback;
     stringCallbackFunction currentStringCallback;
     sysexCallbackFunction currentSysexCallback;
+/* sampling engine */
+    unsigned int samplingInterval;
+    unsigned long previousMillis;
+    uint16_t analogInputsToReport;  // bit n = report analog pin n
+    uint16_t analogInputsToForce;   // bit n = send analog pin n on next sample
+    uint16_t analogInputsSampled;   // bit n = analogValue[n] holds a reading
+    byte analogChannel;             // channel being converted, 0xFF if idle
+    int analogValue[TOTAL_ANALOG_PINS];     // latest conversion
+    int analogSent[TOTAL_ANALOG_PINS];      // last value sent to the host
+    byte analogThreshold[TOTAL_ANALOG_PINS];
+    uint16_t portsToReport;         // bit n = report digital port n
+    uint16_t portsToForce;          // bit n = send port n on next sample
+    byte portInputMask[TOTAL_PORTS];
+    byte portSent[TOTAL_PORTS];
 
 /* private methods ------------------------------ */
     void processSysexMessage(void);
+    void processMultiByteMessage(void);
+    void serviceAnalog(void);
+    void sendValueAsTwo7bitBytes(int value);
+    void startSysex(void);
+    void endSysex(void);
 	void systemReset(void);
     void pin13strobe(int count, int onInterval, int offInterval);
 };
@@ -156,8 +191,5 @@ extern FirmataClass Firmata;
  */
 #define setFirmwareVersion(x, y)   setFirmwareNameAndVersion(__FILE__, x, y)
 
-/* Hardware Abstraction Layer */
-#include "Boards.h"
-
 #endif /* Firmata_h */
 
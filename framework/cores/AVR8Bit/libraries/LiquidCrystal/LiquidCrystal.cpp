@@ -105,6 +105,8 @@ void LiquidCrystal::init(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t en2,
 
   _setCursFlag = 0;
   _direction = LCD_Right;
+  _buffer = NULL;
+  _refreshIndex = 0;
 
   _data_pins[0] = d0;
   _data_pins[1] = d1;
@@ -139,6 +141,15 @@ void LiquidCrystal::init(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t en2,
 
 void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
 {
+  // the shadow buffer is sized for the old dimensions, so it is dropped
+  // here and allocated again once the new ones are set
+  boolean buffered = (_buffer != NULL);
+  if (buffered)
+  {
+    free(_buffer);
+    _buffer = NULL;
+  }
+
   // there is an implied lack of trust;
   // the private version can't be munged up by the user.
   numcols = _numcols = cols;
@@ -157,6 +168,8 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
     _chip = 2;
     begin2(cols,  lines,  dotsize, _en2); //initialize the second HD44780 chip
   }
+
+  if (buffered) setBuffered(true);
 }
 
 void LiquidCrystal::begin2(uint8_t cols, uint8_t lines, uint8_t dotsize, uint8_t enable)
@@ -222,8 +235,8 @@ void LiquidCrystal::begin2(uint8_t cols, uint8_t lines, uint8_t dotsize, uint8_t
   _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
   display();
 
-  // clear it off
-  clear();
+  // clear it off, on the LCD itself even if a shadow buffer is in use
+  clearDisplay();
 
   // Initialize to default text direction (for romance languages)
   _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
@@ -234,6 +247,18 @@ void LiquidCrystal::begin2(uint8_t cols, uint8_t lines, uint8_t dotsize, uint8_t
 /********** high level commands, for the user! */
 
 void LiquidCrystal::clear()
+{
+  if (_buffer)
+  {
+    // blank the shadow screen, refresh() sends what is not blank yet
+    memset(_buffer, ' ', _numlines * _numcols);
+    setCursor(0, 0);
+    return;
+  }
+  clearDisplay();
+}
+
+void LiquidCrystal::clearDisplay()
 {
   if (_en2 != 255)
   {
@@ -254,6 +279,11 @@ void LiquidCrystal::clear()
 
 void LiquidCrystal::home()
 {
+  if (_buffer)
+  {
+    setCursor(0, 0);
+    return;
+  }
   commandBoth(LCD_RETURNHOME);  // set cursor position to zero      //both chips.
   delayPerHome();
   _scroll_count = 0;
@@ -370,6 +400,12 @@ void LiquidCrystal::setCursor(uint8_t col, uint8_t row)         // this can be c
   _y = row;
   _x = col;
   _setCursFlag = 0;  // user did a setCursor--clear the flag that may have been set in write()
+  if (_buffer == NULL) setAddress(col, row);
+}
+
+// moves the LCD's own cursor, without touching the one write() keeps
+void LiquidCrystal::setAddress(uint8_t col, uint8_t row)
+{
   int8_t high_bit = row_offsets[row] & 0x40;  // this keeps coordinates pegged to a spot on the LCD screen even if the user scrolls right or
   int8_t  offset = col + (row_offsets[row] & 0x3f)  + _scroll_count; //left under program control. Previously setCursor was pegged to a location in DDRAM
   //the 3 quantities we add are each <40
@@ -398,6 +434,74 @@ void LiquidCrystal::noAutoscroll(void)
 }
 
 
+/********** shadow buffer */
+
+boolean LiquidCrystal::setBuffered(boolean on)
+{
+  uint8_t cells = _numlines * _numcols;
+
+  if (on)
+  {
+    if (_buffer) return true;
+    _buffer = (uint8_t *)malloc(2 * cells);
+    if (_buffer == NULL) return false;
+    // what is on the screen is not known, so send everything once
+    memset(_buffer, ' ', cells);
+    memset(_buffer + cells, ~' ', cells);
+    _refreshIndex = 0;
+  }
+  else if (_buffer)
+  {
+    refresh();
+    free(_buffer);
+    _buffer = NULL;
+    setCursor(_x, _y);
+  }
+  return true;
+}
+
+boolean LiquidCrystal::refresh(uint8_t maxChars)
+{
+  if (_buffer == NULL) return true;
+
+  uint8_t cells = _numlines * _numcols;
+  uint8_t *shown = _buffer + cells;
+  uint8_t sent = 0;
+  // with left to right entry and no autoscroll the address steps along
+  // by itself, so runs of changed characters need a single setAddress()
+  boolean follows = false;
+  boolean stepping = (_displaymode & LCD_ENTRYLEFT) && !(_displaymode & LCD_ENTRYSHIFTINCREMENT);
+
+  for (uint8_t i = _refreshIndex; i < cells; i++)
+  {
+    if (_buffer[i] == shown[i])
+    {
+      follows = false;
+      continue;
+    }
+    if (maxChars && (sent >= maxChars))
+    {
+      _refreshIndex = i;
+      return false;
+    }
+
+    uint8_t col = i % _numcols;
+    if (!follows || !stepping || (col == 0))
+      setAddress(col, i / _numcols);
+    send(_buffer[i], HIGH);
+    shown[i] = _buffer[i];
+    follows = true;
+    sent++;
+  }
+  _refreshIndex = 0;
+
+  // put a visible cursor back where the next character goes
+  if (sent && (_displaycontrol & (LCD_CURSORON | LCD_BLINKON)))
+    setAddress(_x, _y);
+  return true;
+}
+
+
 /*********** mid level commands, for sending data/cmds */
 inline void LiquidCrystal::command(uint8_t value)
 {
@@ -428,7 +532,17 @@ void LiquidCrystal::write(uint8_t value)
   // first we call setCursor and send the character
   if ((_scroll_count != 0) || (_setCursFlag != 0)) setCursor(_x, _y);
 
-  if ((value != '\r') && (value != '\n')) send(value, HIGH);
+  if ((value != '\r') && (value != '\n'))
+  {
+    if (_buffer == NULL)
+    {
+      send(value, HIGH);
+    }
+    else if ((_x >= 0) && (_x < _numcols) && (_y < _numlines))
+    {
+      _buffer[_y * _numcols + _x] = value;
+    }
+  }
 
   _setCursFlag = 0;
   // then we update the x & y location for the NEXT character
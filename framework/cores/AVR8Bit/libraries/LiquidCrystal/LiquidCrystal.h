@@ -62,7 +62,10 @@ typedef void (*FuncPtr)(int8_t chip);
 #define LCD_Right 0
 #define LCD_Left 1
 
+// wait per command/character when neither RW nor a busy test is given
+#ifndef DELAYPERCHAR
 #define DELAYPERCHAR 320
+#endif
 
 class LiquidCrystal : public Print
 {
@@ -105,6 +108,15 @@ class LiquidCrystal : public Print
     void autoscroll();
     void noAutoscroll();
 
+    // Shadow buffer: while it is on, print(), write(), clear(), home()
+    // and setCursor() only work on a copy of the screen in RAM, and
+    // refresh() sends the characters that differ from what is shown.  refresh(n) sends at
+    // most n of them per call, so the update can be spread over several
+    // passes of loop(); it returns true once the screen is up to date.
+    // begin() keeps the buffer on, resized for the new dimensions.
+    boolean setBuffered(boolean);
+    boolean refresh(uint8_t maxChars = 0);
+
     void createChar(uint8_t, uint8_t[]);
     void setCursor(uint8_t, uint8_t);
     void write(uint8_t);
@@ -121,6 +133,8 @@ class LiquidCrystal : public Print
     void send(uint8_t, uint8_t);
     void write4bits(uint8_t);
     void begin2(uint8_t cols, uint8_t rows, uint8_t charsize, uint8_t chip);
+    void clearDisplay();
+    void setAddress(uint8_t col, uint8_t row);
     inline void delayPerHome(void)
     {
       if ((_rw_pin == 255) && (userFunc == NULL)) delayMicroseconds(2900);
@@ -141,6 +155,9 @@ class LiquidCrystal : public Print
     uint8_t _numlines;
     uint8_t row_offsets[4];
 
+    uint8_t *_buffer;          //shadow screen, then the screen as last sent
+    uint8_t _refreshIndex;     //where an incremental refresh() goes on
+
     uint8_t _displaycontrol;   //display on/off, cursor on/off, blink on/off
     uint8_t _displaymode;      //text direction
 };
@@ -61,13 +61,40 @@ Matrix::Matrix(byte data, byte clock, byte load, byte screens /* = 1 */)
   pinMode(dataPin, OUTPUT);
   pinMode(loadPin, OUTPUT);
 
-  // allocate screenbuffers
-  numberOfScreens = numberOfScreens;
-  buf = (byte*)calloc(numberOfScreens, 64);
+  dataPort = portOutputRegister(digitalPinToPort(dataPin));
+  dataMask = digitalPinToBitMask(dataPin);
+  clockPort = portOutputRegister(digitalPinToPort(clockPin));
+  clockMask = digitalPinToBitMask(clockPin);
+
+  hardwareSPI = false;
+#if defined(SPDR)
+  if (dataPin == MOSI && clockPin == SCK)
+  {
+    // same bits on the SPI hardware: mode 0, msb first, SS kept an
+    // output so the SPI stays master; F_CPU/2 is within the Max7219's
+    // 10MHz up to a 20MHz clock
+    pinMode(SS, OUTPUT);
+    SPCR = _BV(SPE) | _BV(MSTR);
+#if F_CPU <= 20000000L
+    SPSR |= _BV(SPI2X);
+#endif
+    hardwareSPI = true;
+  }
+#endif
+
+  // allocate screenbuffers, drawing and shown rows
+  numberOfScreens = screens;
+  buf = (byte*)calloc(numberOfScreens, 16);
+  shown = buf ? buf + (8 * numberOfScreens) : 0;
   maximumX = (numberOfScreens * 8);
+  dirtyRows = 0;
+  autoFlush = true;
 
   // initialize registers
-  clear();             // clear display
+  for(byte i = 0; i < 8; ++i)
+  {
+    syncRow(i);        // clear display
+  }
   setScanLimit(0x07);  // use all rows/digits
   setBrightness(0x0F); // maximum brightness
   setRegister(REG_SHUTDOWN, 0x01);    // normal operation
@@ -95,7 +122,8 @@ void Matrix::write(int x, int y, byte value)
   buffer(x, y, value);
   
   // update affected row
-  syncRow(y);
+  if (autoFlush)
+    flush();
 }
 
 /*
@@ -103,7 +131,7 @@ void Matrix::write(int x, int y, byte value)
 || | Buffers and writes to screen using the Sprite library
 || #
 */
-void Matrix::write(int x, int y, Sprite sprite)
+void Matrix::write(int x, int y, const Sprite &sprite)
 {
   for (byte i = 0; i < sprite.height(); i++)
   {
@@ -111,8 +139,9 @@ void Matrix::write(int x, int y, Sprite sprite)
     {
       buffer(x + j, y + i, sprite.read(j, i));
     }
-    syncRow(y + i);
   }
+  if (autoFlush)
+    flush();
 }
 
 /*
@@ -133,11 +162,47 @@ void Matrix::clear(void)
     }
   }
 
-  // clear registers
-  for(byte i = 0; i < 8; ++i)
+  dirtyRows = 0xFF;
+  if (autoFlush)
+    flush();
+}
+
+/*
+|| @description
+|| | Turns sending every change straight away on (the default) or off
+|| #
+*/
+void Matrix::setAutoFlush(boolean value)
+{
+  autoFlush = value;
+  if (autoFlush)
+    flush();
+}
+
+/*
+|| @description
+|| | Sends the changed rows to the screens
+|| #
+*/
+void Matrix::flush(void)
+{
+  if (!buf) return;
+
+  for(byte row = 0; row < 8; ++row)
   {
-    syncRow(i);
+    if (!(dirtyRows & (1 << row)))
+      continue;
+    // skip rows that were drawn over with the same pixels
+    for(byte i = 0; i < numberOfScreens; ++i)
+    {
+      if (buf[row + (8 * i)] != shown[row + (8 * i)])
+      {
+        syncRow(row);
+        break;
+      }
+    }
   }
+  dirtyRows = 0;
 }
 
 /// private methods
@@ -145,23 +210,31 @@ void Matrix::clear(void)
 // sends a single byte by sw spi (no latching)
 void Matrix::putByte(byte data)
 {
-  byte i = 8;
-  byte mask;
-  while(i > 0) 
+#if defined(SPDR)
+  if (hardwareSPI)
   {
-    mask = 0x01 << (i - 1);         // get bitmask
-    digitalWrite(clockPin, LOW);   // tick
+    SPDR = data;
+    while (!(SPSR & _BV(SPIF)));
+    return;
+  }
+#endif
+
+  uint8_t oldSREG = SREG;
+  cli();
+  for(byte mask = 0x80; mask; mask >>= 1)
+  {
+    *clockPort &= ~clockMask;      // tick
     if (data & mask)
-    {               // choose bit
-      digitalWrite(dataPin, HIGH); // set 1
+    {                              // choose bit
+      *dataPort |= dataMask;       // set 1
     }
     else
     {
-      digitalWrite(dataPin, LOW);  // set 0
+      *dataPort &= ~dataMask;      // set 0
     }
-    digitalWrite(clockPin, HIGH);  // tock
-    --i;                            // move to lesser bit
+    *clockPort |= clockMask;       // tock
   }
+  SREG = oldSREG;
 }
 
 // sets register to a byte value for all numberOfScreens
@@ -187,6 +260,7 @@ void Matrix::syncRow(int row)
   {
     putByte(8 - row);                // specify register
     putByte(buf[row + (8 * i)]); // send data
+    shown[row + (8 * i)] = buf[row + (8 * i)];
   }
   digitalWrite(loadPin, LOW);  // latch in data
   digitalWrite(loadPin, HIGH); // end
@@ -214,6 +288,8 @@ void Matrix::buffer(int x, int y, byte value)
   }
   --x;
 
+  dirtyRows |= 1 << y;
+
   // record value in buffer
   if(value)
   {
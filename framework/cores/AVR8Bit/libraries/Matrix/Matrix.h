@@ -32,8 +32,14 @@ class Matrix
     
     void setBrightness(byte);
     void write(int, int, byte);
-    void write(int, int, Sprite);
+    void write(int, int, const Sprite &);
     void clear(void);
+
+    // With auto flush off, drawing only changes the buffer and marks
+    // the rows it touched.  flush() then sends the rows that really
+    // changed since the last flush, so whole frames appear at once.
+    void setAutoFlush(boolean);
+    void flush(void);
     
   private:
     void putByte(byte);
@@ -48,7 +54,17 @@ class Matrix
     byte clockPin;
     byte loadPin;
 
-    byte* buf;
+    // pin registers for sw spi, or the SPI hardware on MOSI/SCK
+    volatile uint8_t* dataPort;
+    volatile uint8_t* clockPort;
+    byte dataMask;
+    byte clockMask;
+    boolean hardwareSPI;
+
+    byte* buf;           // drawing buffer, 8 rows per screen
+    byte* shown;         // rows as last sent to the screens
+    byte dirtyRows;      // one bit per row
+    boolean autoFlush;
     byte numberOfScreens;
     byte maximumX;
 };
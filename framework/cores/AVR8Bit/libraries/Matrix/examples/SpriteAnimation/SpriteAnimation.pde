@@ -31,16 +31,18 @@ Sprite wave = Sprite(
 
 void setup()
 { 
+  myMatrix.setAutoFlush(false);    // draw whole frames, then flush()
 }
 
 int x = 0;
 
 void loop()
 {
+  myMatrix.clear();                // clear the buffer for this animation frame
   myMatrix.write(x, 2, wave);      // place sprite on screen
   myMatrix.write(x - 8, 2, wave);  // place sprite again, elsewhere on screen
+  myMatrix.flush();                // send only the rows that changed
   delay(75);                       // wait a little bit
-  myMatrix.clear();                // clear the screen for next animation frame
   if(x == 8)                       // if reached end of animation sequence
   {
     x = 0;                         // start from beginning
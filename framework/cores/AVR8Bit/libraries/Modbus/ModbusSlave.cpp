@@ -0,0 +1,672 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Modbus RTU slave.
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <avr/pgmspace.h>
+#include <Wiring.h>
+#include "ModbusSlave.h"
+
+#define STATE_IDLE        0   // timer stopped, waiting for the first byte of a frame
+#define STATE_RECEIVING   1
+#define STATE_REPLYING    2
+
+// CRC-16/MODBUS (reflected polynomial 0xA001), one lookup per byte so
+// it can be kept up to date in the receive interrupt
+static const uint16_t crcTable[256] PROGMEM = {
+  0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+  0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+  0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+  0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+  0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+  0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+  0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+  0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+  0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+  0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+  0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+  0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+  0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+  0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+  0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+  0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+  0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+  0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+  0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+  0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+  0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+  0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+  0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+  0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+  0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+  0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+  0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+  0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+  0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+  0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+  0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+  0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+static inline uint16_t crc16(uint16_t crc, uint8_t c)
+{
+  return (crc >> 8) ^ pgm_read_word(&crcTable[(uint8_t)(crc ^ c)]);
+}
+
+// timer ticks in a time given in microseconds, for a timer clock in Hz
+static uint32_t ticks(uint32_t clock, uint32_t microseconds)
+{
+  return clock / 1000 * microseconds / 1000;
+}
+
+// the interrupt functions take no arguments
+static ModbusSlave *slave = NULL;
+
+
+/*
+|| @constructor
+|| | Initializes the ModbusSlave, begin() starts it
+|| #
+||
+|| @parameter serial The serial port of the bus
+|| @parameter timer  A 16 bit timer for the frame timing
+*/
+ModbusSlave::ModbusSlave(HardwareSerial &serial, HardwareTimer &timer)
+{
+  _serial = &serial;
+  _timer = &timer;
+  _address = 0;
+  _txEnablePin = -1;
+  _coils.data = _discreteInputs.data = _holdingRegisters.data = _inputRegisters.data = NULL;
+  _coils.count = _discreteInputs.count = _holdingRegisters.count = _inputRegisters.count = 0;
+  _callback = NULL;
+  _state = STATE_IDLE;
+  _messages = 0;
+  _errors = 0;
+}
+
+/*
+|| @description
+|| | Start answering requests.
+|| | Timing follows the Modbus serial line specification: a gap of more
+|| | than 1.5 characters inside a frame drops it, 3.5 characters of
+|| | silence end it, above 19200 baud these are fixed to 750 and 1750 us.
+|| #
+||
+|| @parameter address     The slave address, 1 to 247
+|| @parameter baud        The bit rate
+|| @parameter parity      MODBUS_PARITY_EVEN, MODBUS_PARITY_ODD or MODBUS_PARITY_NONE
+|| @parameter txEnablePin Pin driving the RS-485 driver enable, high while sending, -1 for none
+*/
+void ModbusSlave::begin(uint8_t address, uint32_t baud, uint8_t parity, int txEnablePin)
+{
+  static const uint16_t prescalers[] = { 8, 64, 256, 1024 };
+  static const uint8_t clockSources[] = { CLOCK_PRESCALE_8, CLOCK_PRESCALE_64,
+                                          CLOCK_PRESCALE_256, CLOCK_PRESCALE_1024 };
+  uint32_t characterTime = 11000000UL / baud;   // 11 bits, in microseconds
+  uint32_t gapTime;
+  uint32_t frameTime;
+  uint32_t clock;
+  uint8_t i;
+
+  if (slave != NULL)
+    slave->end();
+
+  _address = address;
+  _txEnablePin = txEnablePin;
+  if (_txEnablePin >= 0)
+  {
+    digitalWrite(_txEnablePin, LOW);
+    pinMode(_txEnablePin, OUTPUT);
+  }
+
+  // The timer is restarted when a byte has been received, which is one
+  // character time after the silence before it started, so the gap
+  // inside a frame is measured as 1.5 characters plus that byte.
+  if (baud > 19200)
+  {
+    gapTime = 750 + characterTime;
+    frameTime = 1750;
+  }
+  else
+  {
+    gapTime = characterTime * 5 / 2;
+    frameTime = characterTime * 7 / 2;
+  }
+
+  // the finest prescaler where the longest time still fits 16 bits
+  for (i = 0; i < 3 && ticks(F_CPU / prescalers[i], frameTime) > 0xFFFF; i++);
+  clock = F_CPU / prescalers[i];
+  _clock = clockSources[i];
+  _characterTicks = ticks(clock, characterTime);
+  _frameTicks = ticks(clock, frameTime);
+  // the transmit FIFO is topped up every 3 characters, well before it runs dry
+  _transmitTicks = 3 * _characterTicks;
+
+  _timer->stop();
+  _timer->setMode(0);
+  _timer->setOCR(CHANNEL_A, _frameTicks);
+  _timer->setOCR(CHANNEL_B, ticks(clock, gapTime));
+  _timer->attachInterrupt(INTERRUPT_COMPARE_MATCH_A, frameTimeout);
+  _timer->attachInterrupt(INTERRUPT_COMPARE_MATCH_B, characterTimeout);
+
+  // no parity takes 2 stop bits to keep the 11 bit character
+  _serial->begin(baud, 8, parity == MODBUS_PARITY_NONE ? 2 : 1, parity);
+
+  uint8_t oldSREG = SREG;
+  cli();
+
+  slave = this;
+  // whatever is on the bus now is the rest of a frame we missed, it
+  // is dropped once the bus has been silent for 3.5 characters
+  _state = STATE_RECEIVING;
+  _length = 0;
+  _bad = 1;
+  _gap = 0;
+  _crc = 0xFFFF;
+  _serial->attachInterrupt(receiveByte);
+  startTimer();
+
+  SREG = oldSREG;
+}
+
+/*
+|| @description
+|| | Stop answering requests and give back the serial port and the timer
+|| #
+*/
+void ModbusSlave::end()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  _serial->detachInterrupt();
+  stopTimer();
+  _timer->detachInterrupt(INTERRUPT_COMPARE_MATCH_A);
+  _timer->detachInterrupt(INTERRUPT_COMPARE_MATCH_B);
+  _state = STATE_IDLE;
+  if (slave == this)
+    slave = NULL;
+
+  SREG = oldSREG;
+
+  _serial->end();
+  if (_txEnablePin >= 0)
+    digitalWrite(_txEnablePin, LOW);
+}
+
+/*
+|| @description
+|| | Serve holding registers (read with function 3, written with 6 and 16)
+|| | from an array of the sketch
+|| #
+||
+|| @parameter registers The registers
+|| @parameter count     Number of registers
+|| @parameter start     Modbus address of registers[0]
+*/
+void ModbusSlave::holdingRegisters(uint16_t *registers, uint16_t count, uint16_t start)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  _holdingRegisters.data = (uint8_t *)registers;
+  _holdingRegisters.count = count;
+  _holdingRegisters.start = start;
+
+  SREG = oldSREG;
+}
+
+/*
+|| @description
+|| | Serve input registers (read with function 4) from an array of the sketch
+|| #
+||
+|| @parameter registers The registers
+|| @parameter count     Number of registers
+|| @parameter start     Modbus address of registers[0]
+*/
+void ModbusSlave::inputRegisters(const uint16_t *registers, uint16_t count, uint16_t start)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  // never written through
+  _inputRegisters.data = (uint8_t *)registers;
+  _inputRegisters.count = count;
+  _inputRegisters.start = start;
+
+  SREG = oldSREG;
+}
+
+/*
+|| @description
+|| | Serve coils (read with function 1, written with 5 and 15) from a
+|| | bit array of the sketch
+|| #
+||
+|| @parameter bits  (count + 7) / 8 bytes, coil start is bit 0 of bits[0]
+|| @parameter count Number of coils
+|| @parameter start Modbus address of the first coil
+*/
+void ModbusSlave::coils(uint8_t *bits, uint16_t count, uint16_t start)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  _coils.data = bits;
+  _coils.count = count;
+  _coils.start = start;
+
+  SREG = oldSREG;
+}
+
+/*
+|| @description
+|| | Serve discrete inputs (read with function 2) from a bit array of the sketch
+|| #
+||
+|| @parameter bits  (count + 7) / 8 bytes, input start is bit 0 of bits[0]
+|| @parameter count Number of inputs
+|| @parameter start Modbus address of the first input
+*/
+void ModbusSlave::discreteInputs(const uint8_t *bits, uint16_t count, uint16_t start)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+
+  // never written through
+  _discreteInputs.data = (uint8_t *)bits;
+  _discreteInputs.count = count;
+  _discreteInputs.start = start;
+
+  SREG = oldSREG;
+}
+
+/*
+|| @description
+|| | Attaches a function that is called after a write request changed
+|| | coils or holding registers, from the interrupt and before the reply
+|| | is sent, so it has to be short
+|| #
+||
+|| @parameter newFunction Gets the function code, the first address and the count
+*/
+void ModbusSlave::attach(writeCallbackFunction newFunction)
+{
+  _callback = newFunction;
+}
+
+/*
+|| @description
+|| | Count the requests for this slave, answered or not
+|| #
+||
+|| @return The count, wraps around at 65535
+*/
+unsigned int ModbusSlave::messages()
+{
+  unsigned int count;
+  uint8_t oldSREG = SREG;
+  cli();
+
+  count = _messages;
+
+  SREG = oldSREG;
+  return count;
+}
+
+/*
+|| @description
+|| | Count the frames that were dropped: bad CRC, a gap inside, too long
+|| #
+||
+|| @return The count, wraps around at 65535
+*/
+unsigned int ModbusSlave::errors()
+{
+  unsigned int count;
+  uint8_t oldSREG = SREG;
+  cli();
+
+  count = _errors;
+
+  SREG = oldSREG;
+  return count;
+}
+
+/// private methods
+
+// serial receive interrupt
+void ModbusSlave::receiveByte(uint8_t c)
+{
+  ModbusSlave *s = slave;
+
+  // half duplex: nothing is taken in while the reply goes out
+  if (s->_state == STATE_REPLYING)
+    return;
+
+  if (s->_state == STATE_IDLE)
+  {
+    s->_state = STATE_RECEIVING;
+    s->_length = 0;
+    s->_bad = 0;
+    s->_gap = 0;
+    s->_crc = 0xFFFF;
+    s->startTimer();
+  }
+  else
+  {
+    s->_timer->setCounter(0);
+    if (s->_gap)
+      s->_bad = 1;
+  }
+
+  if (s->_length < MODBUS_FRAME_SIZE)
+  {
+    s->_frame[s->_length++] = c;
+    s->_crc = crc16(s->_crc, c);
+  }
+  else
+    s->_bad = 1;
+}
+
+// timer compare match B, 1.5 characters of silence
+void ModbusSlave::characterTimeout()
+{
+  if (slave->_state == STATE_RECEIVING)
+    slave->_gap = 1;
+}
+
+// timer compare match A, the frame has ended or the reply needs more bytes
+void ModbusSlave::frameTimeout()
+{
+  ModbusSlave *s = slave;
+
+  if (s->_state == STATE_REPLYING)
+  {
+    s->transmit();
+    return;
+  }
+
+  if (s->_length == 0)
+  {
+    s->stopTimer();
+    return;
+  }
+
+  // the CRC over the frame including its own CRC is 0
+  if (s->_bad || s->_length < 4 || s->_crc != 0)
+  {
+    s->_errors++;
+    s->stopTimer();
+    return;
+  }
+  s->execute();
+}
+
+void ModbusSlave::startTimer()
+{
+  _timer->setCounter(0);
+  _timer->setClockSource(_clock);
+}
+
+void ModbusSlave::stopTimer()
+{
+  _timer->stop();
+  _timer->setOCR(CHANNEL_A, _frameTicks);
+  _state = STATE_IDLE;
+}
+
+void ModbusSlave::execute()
+{
+  uint8_t address = _frame[0];
+  uint8_t function = _frame[1];
+  uint16_t first = (_frame[2] << 8) | _frame[3];
+  uint16_t count = (_frame[4] << 8) | _frame[5];
+  uint16_t length = _length - 2;   // without the CRC
+  uint8_t exception;
+  uint8_t on;
+
+  if ((address != _address && address != 0) ||
+      (address == 0 && function != MODBUS_WRITE_SINGLE_COIL && function != MODBUS_WRITE_SINGLE_REGISTER &&
+       function != MODBUS_WRITE_MULTIPLE_COILS && function != MODBUS_WRITE_MULTIPLE_REGISTERS))
+  {
+    stopTimer();
+    return;
+  }
+  _messages++;
+
+  // the read functions start their reply themselves
+  switch (function)
+  {
+    case MODBUS_READ_COILS:
+    case MODBUS_READ_DISCRETE_INPUTS:
+      if (length != 6 || count < 1 || count > 2000)
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+        exception = readBits(function == MODBUS_READ_COILS ? _coils : _discreteInputs, first, count);
+      break;
+
+    case MODBUS_READ_HOLDING_REGISTERS:
+    case MODBUS_READ_INPUT_REGISTERS:
+      if (length != 6 || count < 1 || count > 125)
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+        exception = readRegisters(function == MODBUS_READ_HOLDING_REGISTERS ? _holdingRegisters : _inputRegisters,
+                                  first, count);
+      break;
+
+    case MODBUS_WRITE_SINGLE_COIL:
+      on = (count == 0xFF00);
+      if (length != 6 || (count != 0xFF00 && count != 0))
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+      {
+        count = 1;
+        exception = writeBits(_coils, first, count, &on);
+      }
+      break;
+
+    case MODBUS_WRITE_SINGLE_REGISTER:
+      if (length != 6)
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+      {
+        count = 1;
+        exception = writeRegisters(_holdingRegisters, first, count, _frame + 4);
+      }
+      break;
+
+    case MODBUS_WRITE_MULTIPLE_COILS:
+      if (length < 7 || count < 1 || count > 1968 || _frame[6] != (count + 7) / 8 || length != 7 + _frame[6])
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+        exception = writeBits(_coils, first, count, _frame + 7);
+      break;
+
+    case MODBUS_WRITE_MULTIPLE_REGISTERS:
+      if (length < 7 || count < 1 || count > 123 || _frame[6] != 2 * count || length != 7 + _frame[6])
+        exception = MODBUS_ILLEGAL_DATA_VALUE;
+      else
+        exception = writeRegisters(_holdingRegisters, first, count, _frame + 7);
+      break;
+
+    default:
+      exception = MODBUS_ILLEGAL_FUNCTION;
+      break;
+  }
+
+  if (exception != 0)
+  {
+    _frame[1] |= 0x80;
+    _frame[2] = exception;
+    if (address != 0)
+      reply(3);
+    else
+      stopTimer();
+  }
+  else if (_state != STATE_REPLYING)
+  {
+    // a write went through, the reply repeats the start of the request
+    if (_callback != NULL)
+      (*_callback)(function, first, count);
+    if (address != 0)
+      reply(6);
+    else
+      stopTimer();
+  }
+}
+
+static uint8_t inMap(uint16_t mapStart, uint16_t mapCount, uint16_t address, uint16_t count)
+{
+  return address >= mapStart && (uint32_t)(address - mapStart) + count <= mapCount;
+}
+
+uint8_t ModbusSlave::readBits(const Map &map, uint16_t address, uint16_t count)
+{
+  uint16_t bytes = (count + 7) / 8;
+  uint16_t mapBytes = (map.count + 7) / 8;
+  uint16_t bit;
+  uint16_t i;
+
+  if (map.data == NULL || !inMap(map.start, map.count, address, count))
+    return MODBUS_ILLEGAL_DATA_ADDRESS;
+  if (3 + bytes > MODBUS_FRAME_SIZE)
+    return MODBUS_ILLEGAL_DATA_VALUE;
+
+  // a byte at a time, shifted into place
+  bit = address - map.start;
+  for (i = 0; i < bytes; i++, bit += 8)
+  {
+    uint16_t index = bit >> 3;
+    uint8_t shift = bit & 7;
+    uint8_t value = map.data[index] >> shift;
+    if (shift && index + 1 < mapBytes)
+      value |= map.data[index + 1] << (8 - shift);
+    _frame[3 + i] = value;
+  }
+  // the unused bits of the last byte are zero
+  if (count & 7)
+    _frame[2 + bytes] &= (1 << (count & 7)) - 1;
+  _frame[2] = bytes;
+
+  reply(3 + bytes);
+  return 0;
+}
+
+uint8_t ModbusSlave::writeBits(const Map &map, uint16_t address, uint16_t count, const uint8_t *values)
+{
+  uint16_t bit;
+  uint16_t i;
+
+  if (map.data == NULL || !inMap(map.start, map.count, address, count))
+    return MODBUS_ILLEGAL_DATA_ADDRESS;
+
+  bit = address - map.start;
+  for (i = 0; i < count; i++, bit++)
+  {
+    uint8_t mask = 1 << (bit & 7);
+    if (values[i >> 3] & (1 << (i & 7)))
+      map.data[bit >> 3] |= mask;
+    else
+      map.data[bit >> 3] &= ~mask;
+  }
+  return 0;
+}
+
+uint8_t ModbusSlave::readRegisters(const Map &map, uint16_t address, uint16_t count)
+{
+  uint16_t *registers = (uint16_t *)map.data + (address - map.start);
+  uint8_t *p = _frame + 3;
+  uint16_t i;
+
+  if (map.data == NULL || !inMap(map.start, map.count, address, count))
+    return MODBUS_ILLEGAL_DATA_ADDRESS;
+  if (3 + 2 * count > MODBUS_FRAME_SIZE)
+    return MODBUS_ILLEGAL_DATA_VALUE;
+
+  // copied here, in the interrupt, so that the reply shows the registers
+  // as they were at one moment even though it goes out over several
+  for (i = 0; i < count; i++)
+  {
+    *p++ = registers[i] >> 8;
+    *p++ = registers[i];
+  }
+  _frame[2] = 2 * count;
+  reply(3 + 2 * count);
+  return 0;
+}
+
+uint8_t ModbusSlave::writeRegisters(const Map &map, uint16_t address, uint16_t count, const uint8_t *values)
+{
+  uint16_t *registers = (uint16_t *)map.data;
+  uint16_t i;
+
+  if (map.data == NULL || !inMap(map.start, map.count, address, count))
+    return MODBUS_ILLEGAL_DATA_ADDRESS;
+
+  registers += address - map.start;
+  for (i = 0; i < count; i++, values += 2)
+    registers[i] = (values[0] << 8) | values[1];
+  return 0;
+}
+
+// start sending _frame[0..length)
+void ModbusSlave::reply(uint8_t length)
+{
+  _replyLength = length;
+  _sent = 0;
+  _crc = 0xFFFF;
+  _state = STATE_REPLYING;
+
+  if (_txEnablePin >= 0)
+    digitalWrite(_txEnablePin, HIGH);
+  _timer->setOCR(CHANNEL_A, _transmitTicks);
+  transmit();
+}
+
+// fill the transmit FIFO without blocking, called again by the timer
+void ModbusSlave::transmit()
+{
+  uint16_t total = _replyLength + 2;
+  uint8_t c;
+
+  while (_sent < total && _serial->availableForWrite() > 0)
+  {
+    if (_sent < _replyLength)
+      c = _frame[_sent];
+    else if (_sent == total - 2)
+      c = _crc;
+    else
+      c = _crc >> 8;
+    if (_sent < total - 2)
+      _crc = crc16(_crc, c);
+    _serial->write(c);
+    _sent++;
+  }
+
+  if (_sent == total)
+  {
+    if (!_serial->transmitting())
+    {
+      if (_txEnablePin >= 0)
+        digitalWrite(_txEnablePin, LOW);
+      stopTimer();
+      return;
+    }
+    // release the bus within a character of the last stop bit
+    _timer->setOCR(CHANNEL_A, _characterTicks);
+  }
+  _timer->setCounter(0);
+}
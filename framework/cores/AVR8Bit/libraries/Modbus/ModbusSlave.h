@@ -0,0 +1,173 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Modbus RTU slave.
+|| |
+|| | Everything happens in interrupts, so the response time does not
+|| | depend on how long loop() takes:
+|| | - every received byte goes straight from the serial receive
+|| |   interrupt into the frame buffer, the CRC is updated with a table
+|| |   lookup and a hardware timer is restarted
+|| | - a compare match of the timer 1.5 character times after a byte
+|| |   marks a gap inside the frame, one 3.5 character times after it
+|| |   ends the frame, which is then checked and executed
+|| | - the same timer then feeds the reply to the serial port a few
+|| |   bytes at a time and releases the RS-485 driver once the last
+|| |   byte is out
+|| |
+|| | The register and coil maps belong to the sketch: requests read and
+|| | write its arrays directly, the maps are never copied.  Registers are
+|| | native uint16_t, coils and discrete inputs are packed 8 to a byte,
+|| | lowest number in bit 0.  A read request takes what it needs from the
+|| | maps at once, in the interrupt that executes it, and the reply is
+|| | sent from that copy.  Since this can happen at any time, values that
+|| | the sketch changes in more than one byte (a register, or two
+|| | registers that belong together) should be updated between
+|| | noInterrupts() and interrupts().
+|| |
+|| | Supported functions: 1 read coils, 2 read discrete inputs,
+|| | 3 read holding registers, 4 read input registers, 5 write single
+|| | coil, 6 write single register, 15 write multiple coils and
+|| | 16 write multiple registers.  Broadcasts (address 0) are executed
+|| | for the write functions and never answered.
+|| |
+|| | The timer has to be a 16 bit one (Timer1, Timer3, ...) that is not
+|| | used for anything else, this includes PWM on its pins.  There can
+|| | be one ModbusSlave running at a time.
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @example
+|| | uint16_t registers[10];
+|| | ModbusSlave modbus(Serial1, Timer3);
+|| |
+|| | modbus.holdingRegisters(registers, 10);
+|| | modbus.begin(17, 19200, MODBUS_PARITY_EVEN, 4);
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef MODBUSSLAVE_H
+#define MODBUSSLAVE_H
+
+#include <inttypes.h>
+#include <HardwareSerial.h>
+#include <WHardwareTimer.h>
+
+// largest RTU frame, smaller values save RAM but drop longer requests
+#ifndef MODBUS_FRAME_SIZE
+#define MODBUS_FRAME_SIZE 256
+#endif
+
+#define MODBUS_PARITY_NONE    0   // sent with 2 stop bits, as the standard asks
+#define MODBUS_PARITY_ODD     1
+#define MODBUS_PARITY_EVEN    2
+
+// function codes
+#define MODBUS_READ_COILS                 1
+#define MODBUS_READ_DISCRETE_INPUTS       2
+#define MODBUS_READ_HOLDING_REGISTERS     3
+#define MODBUS_READ_INPUT_REGISTERS       4
+#define MODBUS_WRITE_SINGLE_COIL          5
+#define MODBUS_WRITE_SINGLE_REGISTER      6
+#define MODBUS_WRITE_MULTIPLE_COILS       15
+#define MODBUS_WRITE_MULTIPLE_REGISTERS   16
+
+// exception codes
+#define MODBUS_ILLEGAL_FUNCTION           1
+#define MODBUS_ILLEGAL_DATA_ADDRESS       2
+#define MODBUS_ILLEGAL_DATA_VALUE         3
+
+class ModbusSlave
+{
+  public:
+    // called from the interrupt after a write request changed the maps
+    typedef void (*writeCallbackFunction)(uint8_t function, uint16_t address, uint16_t count);
+
+    ModbusSlave(HardwareSerial &serial, HardwareTimer &timer);
+
+    void begin(uint8_t address, uint32_t baud = 19200,
+               uint8_t parity = MODBUS_PARITY_EVEN, int txEnablePin = -1);
+    void end();
+
+    // maps start at Modbus address start, count is in registers or bits
+    void holdingRegisters(uint16_t *registers, uint16_t count, uint16_t start = 0);
+    void inputRegisters(const uint16_t *registers, uint16_t count, uint16_t start = 0);
+    void coils(uint8_t *bits, uint16_t count, uint16_t start = 0);
+    void discreteInputs(const uint8_t *bits, uint16_t count, uint16_t start = 0);
+
+    void attach(writeCallbackFunction newFunction);
+
+    // requests for this slave that were executed or answered with an exception
+    unsigned int messages();
+    // frames dropped for a bad CRC, a gap inside or overflowing the buffer
+    unsigned int errors();
+
+  private:
+    struct Map
+    {
+      uint8_t *data;
+      uint16_t count;
+      uint16_t start;
+    };
+
+    static void receiveByte(uint8_t c);
+    static void characterTimeout();
+    static void frameTimeout();
+
+    void startTimer();
+    void stopTimer();
+    void execute();
+    uint8_t readBits(const Map &map, uint16_t address, uint16_t count);
+    uint8_t writeBits(const Map &map, uint16_t address, uint16_t count, const uint8_t *values);
+    uint8_t readRegisters(const Map &map, uint16_t address, uint16_t count);
+    uint8_t writeRegisters(const Map &map, uint16_t address, uint16_t count, const uint8_t *values);
+    void reply(uint8_t length);
+    void transmit();
+
+    HardwareSerial *_serial;
+    HardwareTimer *_timer;
+    uint8_t _address;
+    int _txEnablePin;
+
+    Map _coils;
+    Map _discreteInputs;
+    Map _holdingRegisters;
+    Map _inputRegisters;
+
+    writeCallbackFunction _callback;
+
+    // timing, in timer ticks
+    uint8_t _clock;
+    uint16_t _characterTicks;
+    uint16_t _frameTicks;
+    uint16_t _transmitTicks;
+
+    volatile uint8_t _state;
+    uint8_t _gap;             // 1.5 character times passed since the last byte
+    uint8_t _bad;             // the frame being received is dropped
+    uint16_t _crc;
+
+    uint8_t _frame[MODBUS_FRAME_SIZE];
+    uint16_t _length;
+
+    // the reply is _frame[0.._replyLength), then the CRC
+    uint8_t _replyLength;
+    uint16_t _sent;
+
+    volatile unsigned int _messages;
+    volatile unsigned int _errors;
+
+    // the interrupts reach the slave through this, copies are not allowed
+    ModbusSlave(const ModbusSlave &);
+    ModbusSlave &operator = (const ModbusSlave &);
+};
+
+#endif
+// MODBUSSLAVE_H
@@ -0,0 +1,55 @@
+/**
+ * Register Map
+ *
+ * A Modbus RTU slave at address 17 on Serial1, 19200 baud, even parity.
+ * The RS-485 driver enable (DE and /RE tied together) is on pin 4.
+ *
+ * Input registers 0-7 hold the analog inputs, holding register 0 sets
+ * the PWM on pin 29 and coil 0 switches the on-board LED.
+ * Requests are answered from interrupts, loop() only keeps the maps
+ * up to date.
+ */
+
+#include <ModbusSlave.h>
+
+uint16_t inputs[8];
+uint16_t holding[4];
+uint8_t coils[1];
+
+ModbusSlave modbus(Serial1, Timer3);
+
+// called from the interrupt after the master wrote something
+void written(uint8_t function, uint16_t address, uint16_t count)
+{
+  if (function == MODBUS_WRITE_SINGLE_COIL || function == MODBUS_WRITE_MULTIPLE_COILS)
+    digitalWrite(WLED, coils[0] & 1);
+}
+
+void setup()
+{
+  pinMode(WLED, OUTPUT);
+  modbus.inputRegisters(inputs, 8);
+  modbus.holdingRegisters(holding, 4);
+  modbus.coils(coils, 1);
+  modbus.attach(written);
+  modbus.begin(17, 19200, MODBUS_PARITY_EVEN, 4);
+}
+
+void loop()
+{
+  uint16_t pwm;
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint16_t value = analogRead(i);
+    // a register is two bytes, keep a request from seeing half of it
+    noInterrupts();
+    inputs[i] = value;
+    interrupts();
+  }
+
+  noInterrupts();
+  pwm = holding[0];
+  interrupts();
+  analogWrite(29, pwm);
+}
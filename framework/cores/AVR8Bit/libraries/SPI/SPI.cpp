@@ -19,6 +19,20 @@
 #include "SPI.h"
 
 
+const uint8_t *WSPI::asyncTx;
+uint8_t *WSPI::asyncRx;
+size_t WSPI::asyncCount;
+volatile boolean WSPI::asyncBusy = false;
+void (*WSPI::asyncCallback)(void);
+void (*WSPI::userInterrupt)(void) = 0;
+
+SPITransaction *WSPI::queue[SPI_QUEUE_LENGTH];
+uint8_t WSPI::queueHead = 0;
+uint8_t WSPI::queueCount = 0;
+SPITransaction *volatile WSPI::current = 0;
+volatile boolean WSPI::locked = false;
+
+
 // default is MASTER
 void WSPI::begin() 
 {
@@ -69,6 +83,266 @@ uint8_t WSPI::transfer(uint8_t data)
 }
 
 
+// Block transfers keep the bus busy: the next byte is fetched while
+// the current one is shifted out, and written to SPDR as soon as SPIF
+// is set.  The received byte is taken from SPDR before that, an
+// interrupt between starting the next byte and reading SPDR could let
+// the next byte overwrite it.
+void WSPI::transfer(const uint8_t *tx, uint8_t *rx, size_t n)
+{
+  uint8_t out;
+  uint8_t in;
+
+  if (!rx)
+  {
+    write(tx, n);
+    return;
+  }
+  if (!n)
+    return;
+
+  SPDR = tx ? *tx++ : SPI_FILL_BYTE;
+  while (--n)
+  {
+    out = tx ? *tx++ : SPI_FILL_BYTE;
+    while (!(SPSR & _BV(SPIF)));
+    in = SPDR;
+    SPDR = out;
+    *rx++ = in;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  *rx = SPDR;
+}
+
+
+void WSPI::write(const uint8_t *buffer, size_t n)
+{
+  uint8_t out;
+
+  if (!n)
+    return;
+
+  if (!buffer)
+  {
+    // clock out fill bytes only
+    SPDR = SPI_FILL_BYTE;
+    while (--n)
+    {
+      while (!(SPSR & _BV(SPIF)));
+      SPDR = SPI_FILL_BYTE;
+    }
+  }
+  else
+  {
+    SPDR = *buffer++;
+    while (--n)
+    {
+      out = *buffer++;
+      while (!(SPSR & _BV(SPIF)));
+      SPDR = out;
+    }
+  }
+  while (!(SPSR & _BV(SPIF)));
+  // clear SPIF for whoever uses the bus next
+  out = SPDR;
+}
+
+
+// Interrupt driven transfer, using the SPI interrupt hook (so it takes
+// the place of a function set with attachInterrupt(), which is put back
+// when it is done; don't call attachInterrupt() while it runs).  The interrupt costs more than a byte takes at SPI_CLOCK_DIV2
+// or DIV4, so use it to free the cpu at the slower clock rates.
+boolean WSPI::transferAsync(const uint8_t *tx, uint8_t *rx, size_t n, void (*callback)(void))
+{
+  if (asyncBusy)
+    return false;
+
+  if (!n)
+  {
+    if (callback)
+      callback();
+    return true;
+  }
+
+  asyncTx = tx;
+  asyncRx = rx;
+  asyncCallback = callback;
+  asyncCount = n;
+  asyncBusy = true;
+
+  // drop a stale SPIF, then start the first byte with the interrupt on
+  if (SPSR & _BV(SPIF))
+    (void)SPDR;
+  attachInterruptSPI(asyncService);
+  SPDR = asyncTx ? *asyncTx++ : SPI_FILL_BYTE;
+  SPCR |= _BV(SPIE);
+
+  return true;
+}
+
+
+void WSPI::asyncService(void)
+{
+  uint8_t in = SPDR;
+
+  if (--asyncCount)
+  {
+    SPDR = asyncTx ? *asyncTx++ : SPI_FILL_BYTE;
+    if (asyncRx)
+      *asyncRx++ = in;
+    return;
+  }
+
+  if (asyncRx)
+    *asyncRx = in;
+  if (userInterrupt)
+  {
+    // SPIE stays on for it
+    attachInterruptSPI(userInterrupt);
+  }
+  else
+  {
+    SPCR &= ~_BV(SPIE);
+    detachInterruptSPI();
+  }
+  asyncBusy = false;
+  if (asyncCallback)
+    asyncCallback();
+}
+
+
+// wait until the bus is free and take it
+void WSPI::lock()
+{
+  uint8_t oldSREG;
+
+  for (;;)
+  {
+    oldSREG = SREG;
+    cli();
+    if (!locked && !current && !asyncBusy)
+    {
+      locked = true;
+      SREG = oldSREG;
+      return;
+    }
+    SREG = oldSREG;
+  }
+}
+
+
+// give the bus back and start anything that queued up meanwhile
+void WSPI::unlock()
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  locked = false;
+  startQueued();
+  SREG = oldSREG;
+}
+
+
+boolean WSPI::enqueue(SPITransaction *t)
+{
+  uint8_t oldSREG = SREG;
+  uint8_t tail;
+
+  cli();
+  if (queueCount >= SPI_QUEUE_LENGTH)
+  {
+    SREG = oldSREG;
+    return false;
+  }
+
+  t->status = SPI_PENDING;
+  tail = queueHead + queueCount;
+  if (tail >= SPI_QUEUE_LENGTH)
+    tail -= SPI_QUEUE_LENGTH;
+  queue[tail] = t;
+  queueCount++;
+
+  startQueued();
+  SREG = oldSREG;
+  return true;
+}
+
+
+// start the next queued transfer if the bus is free
+// called with interrupts disabled
+void WSPI::startQueued(void)
+{
+  SPITransaction *t;
+
+  if (locked || current || asyncBusy || !queueCount)
+    return;
+
+  t = queue[queueHead];
+  if (++queueHead >= SPI_QUEUE_LENGTH)
+    queueHead = 0;
+  queueCount--;
+
+  current = t;
+  t->device->apply();
+  t->device->select();
+  SPI.transferAsync(t->txBuffer, t->rxBuffer, t->length, queueService);
+}
+
+
+void WSPI::queueService(void)
+{
+  SPITransaction *t = current;
+
+  t->device->deselect();
+  current = 0;
+  t->status = 0;
+  if (t->callback)
+    t->callback(t);
+  startQueued();
+}
+
+
+SPIDevice::SPIDevice(uint8_t csPin, uint8_t dataMode, uint8_t bitOrder, uint8_t clockDivider)
+{
+  // work the register values out once, so switching devices is cheap
+  _spcr = _BV(SPE) | _BV(MSTR) | (dataMode & SPI_MODE_MASK) | (clockDivider & SPI_CLOCK_MASK);
+  if (bitOrder == LSBFIRST)
+    _spcr |= _BV(DORD);
+  _spsr = (clockDivider >> 2) & SPI_2XCLOCK_MASK;
+
+  _csPin = csPin;
+  _csPort = digitalPinToPortReg(csPin);
+  _csMask = digitalPinToBitMask(csPin);
+}
+
+
+void SPIDevice::begin()
+{
+  deselect();
+  pinMode(_csPin, OUTPUT);
+}
+
+
+void SPIDevice::select()
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  *_csPort &= ~_csMask;
+  SREG = oldSREG;
+}
+
+
+void SPIDevice::deselect()
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  *_csPort |= _csMask;
+  SREG = oldSREG;
+}
+
+
 void WSPI::setBitOrder(uint8_t bitOrder) {
   if(bitOrder == LSBFIRST) {
     SPCR |= _BV(DORD);
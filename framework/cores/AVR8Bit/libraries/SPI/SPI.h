@@ -46,6 +46,34 @@
 #define SPI_CLOCK_MASK 0x03  // SPR1 = bit 1, SPR0 = bit 0 on SPCR
 #define SPI_2XCLOCK_MASK 0x01  // SPI2X = bit 0 on SPSR
 
+// sent by block transfers that have nothing to transmit
+#define SPI_FILL_BYTE 0xFF
+
+// queued transfers waiting for the bus
+#ifndef SPI_QUEUE_LENGTH
+#define SPI_QUEUE_LENGTH 4
+#endif
+
+// SPITransaction status while it is queued or running
+#define SPI_PENDING 0xFF
+
+
+class SPIDevice;
+
+// A block transfer for a device, run from the SPI interrupt once the
+// bus is free.  The buffers and the transaction itself must stay valid
+// until status is no longer SPI_PENDING.  callback, if set, is called
+// from the interrupt when it is done.
+struct SPITransaction
+{
+  SPIDevice *device;
+  const uint8_t *txBuffer;
+  uint8_t *rxBuffer;
+  size_t length;
+  volatile uint8_t status;
+  void (*callback)(SPITransaction *);
+};
+
 
 class WSPI
 {
@@ -54,16 +82,50 @@ class WSPI
     void begin(uint8_t mode, uint8_t bitOrder=MSBFIRST, uint8_t dataMode=SPI_MODE3, uint8_t clockRate=SPI_CLOCK_DIV4);
     static void end();
     uint8_t transfer(uint8_t);
+    // block transfers, tx or rx may be NULL
+    void transfer(const uint8_t *, uint8_t *, size_t);
+    void write(const uint8_t *, size_t);
+    // interrupt driven block transfer, returns false if one is running
+    // callback, if set, is called from the SPI interrupt when it is done
+    boolean transferAsync(const uint8_t *, uint8_t *, size_t, void (*callback)(void) = 0);
+    static boolean isBusy()
+    {
+      return asyncBusy;
+    }
     static void setBitOrder(uint8_t);
     static void setDataMode(uint8_t);
     static void setClockDivider(uint8_t);
     inline static void attachInterrupt(void (*userFunc)(void));
     inline static void detachInterrupt();
+
+    // bus sharing, see SPIDevice
+    static void lock();
+    static void unlock();
+    static boolean enqueue(SPITransaction *);
+
+  private:
+    static const uint8_t *asyncTx;
+    static uint8_t *asyncRx;
+    static size_t asyncCount;
+    static volatile boolean asyncBusy;
+    static void (*asyncCallback)(void);
+    static void asyncService(void);
+    // set with attachInterrupt(), put back once an async transfer is done
+    static void (*userInterrupt)(void);
+
+    static SPITransaction *queue[SPI_QUEUE_LENGTH];
+    static uint8_t queueHead;
+    static uint8_t queueCount;
+    static SPITransaction *volatile current;
+    static volatile boolean locked;
+    static void startQueued(void);
+    static void queueService(void);
 };
 
 
 void WSPI::attachInterrupt(void (*userFunc)(void)) {
 //  spiIntFunc = userFunc;
+  userInterrupt = userFunc;
   attachInterruptSPI(userFunc);
   SPCR |= _BV(SPIE);
 }
@@ -71,10 +133,77 @@ void WSPI::attachInterrupt(void (*userFunc)(void)) {
 void WSPI::detachInterrupt() {
   SPCR &= ~_BV(SPIE);
 //  spiIntFunc = 0;
+  userInterrupt = 0;
   detachInterruptSPI();
 }
 
 
 extern WSPI SPI;
 
+
+// A device on the SPI bus: its mode, bit order and clock divider, and
+// its chip select pin.  beginTransaction() waits for the bus, sets the
+// registers (only if another device changed them) and selects the chip;
+// endTransaction() deselects it and lets queued transfers run.  Code in
+// interrupts must not wait for the bus, it uses enqueue() instead.
+class SPIDevice
+{
+  public:
+    SPIDevice(uint8_t csPin, uint8_t dataMode = SPI_MODE0, uint8_t bitOrder = MSBFIRST, uint8_t clockDivider = SPI_CLOCK_DIV4);
+
+    // chip select pin to output, deselected; call SPI.begin() first
+    void begin();
+
+    void beginTransaction()
+    {
+      WSPI::lock();
+      apply();
+      select();
+    }
+    void endTransaction()
+    {
+      deselect();
+      WSPI::unlock();
+    }
+
+    uint8_t transfer(uint8_t data)
+    {
+      return SPI.transfer(data);
+    }
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t n)
+    {
+      SPI.transfer(tx, rx, n);
+    }
+    void write(const uint8_t *buffer, size_t n)
+    {
+      SPI.write(buffer, n);
+    }
+
+    // queue an interrupt driven transfer, returns false if the queue is
+    // full; safe to call from interrupts
+    boolean enqueue(SPITransaction *t)
+    {
+      t->device = this;
+      return WSPI::enqueue(t);
+    }
+
+    // set the registers for this device, skipped if they are already set
+    void apply()
+    {
+      if (SPCR != _spcr)
+        SPCR = _spcr;
+      if ((SPSR & SPI_2XCLOCK_MASK) != _spsr)
+        SPSR = _spsr;
+    }
+    void select();
+    void deselect();
+
+  private:
+    uint8_t _spcr;
+    uint8_t _spsr;
+    uint8_t _csPin;
+    volatile uint8_t *_csPort;
+    uint8_t _csMask;
+};
+
 #endif
@@ -0,0 +1,208 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | SPI master on a USART in Master SPI Mode (MSPIM).
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include "USARTSPI.h"
+
+#if defined(UMSEL01) || defined(UMSEL11)
+
+// register bits, at the same place on every USART
+// UCSRnA
+#define MSPIM_RXC    7
+#define MSPIM_TXC    6
+#define MSPIM_UDRE   5
+// UCSRnB
+#define MSPIM_RXEN   4
+#define MSPIM_TXEN   3
+// UCSRnC
+#define MSPIM_UMSEL1 7
+#define MSPIM_UMSEL0 6
+#define MSPIM_UDORD  2
+#define MSPIM_UCPHA  1
+#define MSPIM_UCPOL  0
+
+
+USARTSPI::USARTSPI(uint8_t usartNumber, uint8_t xckPin)
+{
+  _xckPin = xckPin;
+
+  switch (usartNumber)
+  {
+#if defined(UMSEL01)
+    case 0:
+      _ubrrh = &UBRR0H;
+      _ubrrl = &UBRR0L;
+      _ucsra = &UCSR0A;
+      _ucsrb = &UCSR0B;
+      _ucsrc = &UCSR0C;
+      _udr = &UDR0;
+      break;
+#endif
+#if defined(UMSEL11)
+    case 1:
+      _ubrrh = &UBRR1H;
+      _ubrrl = &UBRR1L;
+      _ucsra = &UCSR1A;
+      _ucsrb = &UCSR1B;
+      _ucsrc = &UCSR1C;
+      _udr = &UDR1;
+      break;
+#endif
+#if defined(UMSEL21)
+    case 2:
+      _ubrrh = &UBRR2H;
+      _ubrrl = &UBRR2L;
+      _ucsra = &UCSR2A;
+      _ucsrb = &UCSR2B;
+      _ucsrc = &UCSR2C;
+      _udr = &UDR2;
+      break;
+#endif
+#if defined(UMSEL31)
+    case 3:
+      _ubrrh = &UBRR3H;
+      _ubrrl = &UBRR3L;
+      _ucsra = &UCSR3A;
+      _ucsrb = &UCSR3B;
+      _ucsrc = &UCSR3C;
+      _udr = &UDR3;
+      break;
+#endif
+  }
+}
+
+
+void USARTSPI::begin(uint8_t bitOrder, uint8_t dataMode, uint32_t clock)
+{
+  // the baud rate register has to be 0 while the transmitter is enabled
+  *_ubrrh = 0;
+  *_ubrrl = 0;
+  pinMode(_xckPin, OUTPUT);
+  *_ucsrc = _BV(MSPIM_UMSEL1) | _BV(MSPIM_UMSEL0);
+  setBitOrder(bitOrder);
+  setDataMode(dataMode);
+  *_ucsrb = _BV(MSPIM_RXEN) | _BV(MSPIM_TXEN);
+  setClock(clock);
+}
+
+
+void USARTSPI::end()
+{
+  // wait for the last byte, then give the pins back
+  while (!(*_ucsra & _BV(MSPIM_UDRE)));
+  *_ucsrb = 0;
+  *_ucsrc = 0;
+}
+
+
+void USARTSPI::setBitOrder(uint8_t bitOrder)
+{
+  if (bitOrder == LSBFIRST)
+    *_ucsrc |= _BV(MSPIM_UDORD);
+  else
+    *_ucsrc &= ~_BV(MSPIM_UDORD);
+}
+
+
+// takes the SPI_MODEn constants of the SPI library
+void USARTSPI::setDataMode(uint8_t mode)
+{
+  uint8_t ucsrc = *_ucsrc & ~(_BV(MSPIM_UCPHA) | _BV(MSPIM_UCPOL));
+
+  if (mode & _BV(CPOL))
+    ucsrc |= _BV(MSPIM_UCPOL);
+  if (mode & _BV(CPHA))
+    ucsrc |= _BV(MSPIM_UCPHA);
+  *_ucsrc = ucsrc;
+}
+
+
+// SCK = F_CPU / (2 * (UBRR + 1)), rounded down to the nearest rate
+void USARTSPI::setClock(uint32_t clock)
+{
+  uint32_t ubrr;
+
+  if (!clock)
+    return;
+  ubrr = (F_CPU / 2 + clock - 1) / clock;
+  ubrr = ubrr ? ubrr - 1 : 0;
+  if (ubrr > 4095)
+    ubrr = 4095;
+  *_ubrrh = ubrr >> 8;
+  *_ubrrl = ubrr;
+}
+
+
+uint8_t USARTSPI::transfer(uint8_t data)
+{
+  while (!(*_ucsra & _BV(MSPIM_UDRE)));
+  *_udr = data;
+  while (!(*_ucsra & _BV(MSPIM_RXC)));
+  return *_udr;
+}
+
+
+// Keeps two bytes in flight, one shifting and one waiting in the
+// transmit buffer, so the clock never stops.  The receive buffer is
+// two bytes deep, so nothing is lost even if a byte is read late.
+void USARTSPI::transfer(const uint8_t *tx, uint8_t *rx, size_t n)
+{
+  size_t sent = 0;
+  size_t received = 0;
+  uint8_t in;
+
+  while (received < n)
+  {
+    if (sent < n && sent - received < 2 && (*_ucsra & _BV(MSPIM_UDRE)))
+    {
+      *_udr = tx ? tx[sent] : SPI_FILL_BYTE;
+      sent++;
+    }
+    if (*_ucsra & _BV(MSPIM_RXC))
+    {
+      in = *_udr;
+      if (rx)
+        rx[received] = in;
+      received++;
+    }
+  }
+}
+
+
+// Write only: the receiver is switched off, so there is nothing to
+// read back and each byte goes out as soon as the buffer has room.
+void USARTSPI::write(const uint8_t *buffer, size_t n)
+{
+  if (!n)
+    return;
+
+  uint8_t oldSREG;
+
+  *_ucsrb = _BV(MSPIM_TXEN);
+  while (n--)
+  {
+    while (!(*_ucsra & _BV(MSPIM_UDRE)));
+    // clear TXC with every byte, a stall between bytes may have let it
+    // set; the other flags are read only or must stay zero in MSPIM mode
+    oldSREG = SREG;
+    cli();
+    *_ucsra = _BV(MSPIM_TXC);
+    *_udr = buffer ? *buffer++ : SPI_FILL_BYTE;
+    SREG = oldSREG;
+  }
+  while (!(*_ucsra & _BV(MSPIM_TXC)));
+  *_ucsrb = _BV(MSPIM_RXEN) | _BV(MSPIM_TXEN);
+}
+
+#endif
@@ -0,0 +1,71 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | SPI master on a USART in Master SPI Mode (MSPIM).
+|| |
+|| | The USART transmitter is double buffered, so block writes keep
+|| | the clock running without gaps between bytes, and every USART
+|| | becomes an extra SPI bus next to the native one.  TXD is MOSI,
+|| | RXD is MISO and XCK is SCK; chip selects are up to the sketch.
+|| | The port can not be used as a HardwareSerial port at the same
+|| | time.
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @example
+|| | USARTSPI leds(1, 5);          // USART1, XCK1 on pin 5
+|| |
+|| | leds.begin(MSBFIRST, SPI_MODE0, 4000000);
+|| | leds.write(frame, sizeof(frame));
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef USARTSPI_h
+#define USARTSPI_h
+
+#include <Wiring.h>
+#include "SPI.h"
+
+// only parts whose USARTs have the MSPIM mode select bits
+#if defined(UMSEL01) || defined(UMSEL11)
+
+class USARTSPI
+{
+  public:
+    // usartNumber as for HardwareSerial, xckPin is the pin with XCKn
+    USARTSPI(uint8_t usartNumber, uint8_t xckPin);
+
+    // clock is the SCK frequency in Hz, at most F_CPU / 2
+    void begin(uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0, uint32_t clock = F_CPU / 4);
+    void end();
+
+    void setBitOrder(uint8_t);
+    void setDataMode(uint8_t);
+    void setClock(uint32_t);
+
+    uint8_t transfer(uint8_t);
+    // block transfers, tx or rx may be NULL
+    void transfer(const uint8_t *, uint8_t *, size_t);
+    void write(const uint8_t *, size_t);
+
+  private:
+    volatile uint8_t *_ubrrh;
+    volatile uint8_t *_ubrrl;
+    volatile uint8_t *_ucsra;
+    volatile uint8_t *_ucsrb;
+    volatile uint8_t *_ucsrc;
+    volatile uint8_t *_udr;
+    uint8_t _xckPin;
+};
+
+#endif
+
+#endif
+// USARTSPI_h
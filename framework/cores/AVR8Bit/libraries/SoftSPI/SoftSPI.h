@@ -0,0 +1,171 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Bit banged SPI master on any three pins, with the SPI API.
+|| |
+|| | The pins are template parameters, so every pin access compiles to
+|| | a single sbi/cbi/sbic instruction and a byte takes well under 10us
+|| | on a 16MHz part.  HALF_PERIOD_US slows the clock down for slow
+|| | devices; setClockDivider() is there for compatibility only.
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @example
+|| | SoftSPI<11, 12, 13> bus;      // MOSI pin 11, MISO pin 12, SCK pin 13
+|| |
+|| | bus.begin(SPI_MASTER, MSBFIRST, SPI_MODE0);
+|| | digitalWrite(csPin, LOW);
+|| | value = bus.transfer(0x80);
+|| | digitalWrite(csPin, HIGH);
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef SoftSPI_h
+#define SoftSPI_h
+
+#include <Wiring.h>
+#include <util/delay.h>
+
+// the constants of the SPI library, unless it is included as well
+#ifndef SPI_MASTER
+#define SPI_MASTER 0x01
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+#define SPI_CLOCK_DIV4 0x00
+#endif
+
+template <uint8_t MOSI_PIN, uint8_t MISO_PIN, uint8_t SCK_PIN, uint8_t HALF_PERIOD_US = 0>
+class SoftSPI
+{
+  public:
+    SoftSPI() : _lsbFirst(false), _cpol(false), _cpha(false) {}
+
+    // master only, mode and clockRate are ignored
+    void begin()
+    {
+      begin(SPI_MASTER, MSBFIRST, SPI_MODE3, SPI_CLOCK_DIV4);
+    }
+    void begin(uint8_t mode, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE3, uint8_t clockRate = SPI_CLOCK_DIV4)
+    {
+      setBitOrder(bitOrder);
+      setDataMode(dataMode);
+      pinMode(MOSI_PIN, OUTPUT);
+      pinMode(MISO_PIN, INPUT);
+      pinMode(SCK_PIN, OUTPUT);
+    }
+    void end()
+    {
+      pinMode(MOSI_PIN, INPUT);
+      pinMode(SCK_PIN, INPUT);
+    }
+
+    void setBitOrder(uint8_t bitOrder)
+    {
+      _lsbFirst = (bitOrder == LSBFIRST);
+    }
+    void setDataMode(uint8_t mode)
+    {
+      // CPOL is bit 3 and CPHA bit 2 in the SPI_MODEn constants
+      _cpol = (mode & 0x08) != 0;
+      _cpha = (mode & 0x04) != 0;
+      sckIdle();
+    }
+    void setClockDivider(uint8_t)
+    {
+    }
+
+    uint8_t transfer(uint8_t data)
+    {
+      uint8_t i;
+      uint8_t in = 0;
+
+      // shift MSB first only, LSB first bytes are turned around
+      if (_lsbFirst)
+        data = reverse(data);
+
+      for (i = 0; i < 8; i++)
+      {
+        if (_cpha)
+          sckActive();
+        if (data & 0x80)
+          pinWrite(MOSI_PIN, HIGH);
+        else
+          pinWrite(MOSI_PIN, LOW);
+        data <<= 1;
+        halfPeriod();
+        if (_cpha)
+          sckIdle();
+        else
+          sckActive();
+        in <<= 1;
+        if (pinRead(MISO_PIN))
+          in |= 1;
+        halfPeriod();
+        if (!_cpha)
+          sckIdle();
+      }
+
+      return _lsbFirst ? reverse(in) : in;
+    }
+
+    // block transfers, tx or rx may be NULL
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t n)
+    {
+      uint8_t in;
+
+      while (n--)
+      {
+        in = transfer(tx ? *tx++ : 0xFF);
+        if (rx)
+          *rx++ = in;
+      }
+    }
+    void write(const uint8_t *buffer, size_t n)
+    {
+      transfer(buffer, 0, n);
+    }
+
+  private:
+    boolean _lsbFirst;
+    boolean _cpol;
+    boolean _cpha;
+
+    static void halfPeriod()
+    {
+      if (HALF_PERIOD_US)
+        _delay_us(HALF_PERIOD_US);
+    }
+    void sckIdle()
+    {
+      if (_cpol)
+        pinWrite(SCK_PIN, HIGH);
+      else
+        pinWrite(SCK_PIN, LOW);
+    }
+    void sckActive()
+    {
+      if (_cpol)
+        pinWrite(SCK_PIN, LOW);
+      else
+        pinWrite(SCK_PIN, HIGH);
+    }
+    static uint8_t reverse(uint8_t b)
+    {
+      b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+      b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+      b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+      return b;
+    }
+};
+
+#endif
+// SoftSPI_h
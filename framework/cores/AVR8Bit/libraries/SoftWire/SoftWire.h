@@ -0,0 +1,280 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Bit banged I2C master on any two pins, with the Wire API.
+|| |
+|| | The pins are template parameters, so every pin access compiles to
+|| | a single sbi/cbi/sbic instruction.  HALF_PERIOD_US defaults to 5,
+|| | 100kHz as with Wire; 1 gives roughly 400kHz.  0 runs the bus as
+|| | fast as the pins toggle (beyond 1MHz on a 16MHz part) without SDA
+|| | setup time, only for devices known to keep up.  Slaves may stretch
+|| | the clock.
+|| |
+|| | The lines are driven open drain (low, or released as inputs), so
+|| | both need external pull up resistors.  Master mode only.
+|| |
+|| | Wiring Core Library
+|| #
+||
+|| @example
+|| | SoftWire<8, 9> bus;           // SDA pin 8, SCL pin 9, 100kHz
+|| |
+|| | bus.begin();
+|| | bus.beginTransmission(0x68);
+|| | bus.write(0x3B);
+|| | bus.endTransmission(0);
+|| | bus.requestFrom(0x68, 6);
+|| | while (bus.available())
+|| |   Serial.println(bus.read());
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef SoftWire_h
+#define SoftWire_h
+
+#include <Wiring.h>
+#include <util/delay.h>
+#include "Stream.h"
+
+template <uint8_t SDA_PIN, uint8_t SCL_PIN, uint8_t HALF_PERIOD_US = 5, uint8_t BUFFER_SIZE = 32>
+class SoftWire : public Stream
+{
+  public:
+    SoftWire() : _rxIndex(0), _rxLength(0), _status(0), _holding(false), _transmitting(false) {}
+
+    void begin()
+    {
+      // output latches low, so switching to output pulls the line low
+      pinWrite(SDA_PIN, LOW);
+      pinWrite(SCL_PIN, LOW);
+      sdaHigh();
+      sclHigh();
+    }
+
+    void beginTransmission(uint8_t address)
+    {
+      _transmitting = true;
+      _status = start((address << 1) | 0) ? 0 : 2;
+    }
+    void beginTransmission(int address)
+    {
+      beginTransmission((uint8_t)address);
+    }
+
+    // 0 success, 2 address NACK, 3 data NACK
+    uint8_t endTransmission(uint8_t sendStop = 1)
+    {
+      _transmitting = false;
+      // always stop after a NACK
+      finish(sendStop || _status);
+      return _status;
+    }
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = 1)
+    {
+      uint8_t i;
+
+      if (quantity > BUFFER_SIZE)
+        quantity = BUFFER_SIZE;
+      _rxIndex = 0;
+      _rxLength = 0;
+      if (!quantity)
+        return 0;
+
+      if (start((address << 1) | 1))
+      {
+        // ack every byte but the last
+        for (i = 0; i < quantity; i++)
+          _rxBuffer[i] = readByte(i + 1 < quantity);
+        _rxLength = quantity;
+      }
+      finish(sendStop || !_rxLength);
+      return _rxLength;
+    }
+    uint8_t requestFrom(int address, int quantity, int sendStop = 1)
+    {
+      return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+    }
+
+    // bytes go out on the bus as they are written
+    void write(uint8_t data)
+    {
+      if (_transmitting && !_status && !writeByte(data))
+        _status = 3;
+    }
+    void write(int data)
+    {
+      write((uint8_t)data);
+    }
+    void write(const uint8_t *data, size_t quantity)
+    {
+      while (quantity--)
+        write(*data++);
+    }
+    using Print::write;
+
+    int available()
+    {
+      return _rxLength - _rxIndex;
+    }
+    int read()
+    {
+      return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1;
+    }
+    int peek()
+    {
+      return _rxIndex < _rxLength ? _rxBuffer[_rxIndex] : -1;
+    }
+    void flush()
+    {
+    }
+
+    // register access, as in Wire
+    uint8_t readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length)
+    {
+      uint8_t i;
+
+      if (!start(address << 1) || !writeByte(reg) || !start((address << 1) | 1))
+      {
+        finish(true);
+        return 0;
+      }
+      for (i = 0; i < length; i++)
+        buffer[i] = readByte(i + 1 < length);
+      finish(true);
+      return length;
+    }
+    uint8_t writeRegisters(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t length)
+    {
+      beginTransmission(address);
+      write(reg);
+      write(buffer, length);
+      return endTransmission();
+    }
+
+  private:
+    uint8_t _rxBuffer[BUFFER_SIZE];
+    uint8_t _rxIndex;
+    uint8_t _rxLength;
+    uint8_t _status;
+    boolean _holding;
+    boolean _transmitting;
+
+    static void halfPeriod()
+    {
+      if (HALF_PERIOD_US)
+        _delay_us(HALF_PERIOD_US);
+    }
+    static void sdaLow()
+    {
+      pinMode(SDA_PIN, OUTPUT);
+    }
+    static void sdaHigh()
+    {
+      pinMode(SDA_PIN, INPUT);
+    }
+    static void sclLow()
+    {
+      pinMode(SCL_PIN, OUTPUT);
+    }
+    static void sclHigh()
+    {
+      pinMode(SCL_PIN, INPUT);
+      // wait while a slave stretches the clock
+      while (!pinRead(SCL_PIN));
+    }
+
+    // (repeated) start and address, true if the address was acked
+    boolean start(uint8_t slarw)
+    {
+      if (_holding)
+      {
+        // bus kept after the last transfer, SCL is low
+        sdaHigh();
+        halfPeriod();
+        sclHigh();
+        halfPeriod();
+      }
+      sdaLow();
+      halfPeriod();
+      sclLow();
+      _holding = true;
+      return writeByte(slarw);
+    }
+
+    // stop, or keep the bus for a repeated start
+    void finish(boolean stop)
+    {
+      if (!stop)
+        return;
+      sdaLow();
+      halfPeriod();
+      sclHigh();
+      halfPeriod();
+      sdaHigh();
+      halfPeriod();
+      _holding = false;
+    }
+
+    // true if the byte was acked
+    boolean writeByte(uint8_t data)
+    {
+      uint8_t i;
+      boolean ack;
+
+      for (i = 0; i < 8; i++)
+      {
+        if (data & 0x80)
+          sdaHigh();
+        else
+          sdaLow();
+        data <<= 1;
+        halfPeriod();
+        sclHigh();
+        halfPeriod();
+        sclLow();
+      }
+      sdaHigh();
+      halfPeriod();
+      sclHigh();
+      ack = !pinRead(SDA_PIN);
+      halfPeriod();
+      sclLow();
+      return ack;
+    }
+
+    uint8_t readByte(boolean ack)
+    {
+      uint8_t i;
+      uint8_t data = 0;
+
+      sdaHigh();
+      for (i = 0; i < 8; i++)
+      {
+        halfPeriod();
+        sclHigh();
+        data <<= 1;
+        if (pinRead(SDA_PIN))
+          data |= 1;
+        halfPeriod();
+        sclLow();
+      }
+      if (ack)
+        sdaLow();
+      halfPeriod();
+      sclHigh();
+      halfPeriod();
+      sclLow();
+      sdaHigh();
+      return data;
+    }
+};
+
+#endif
+// SoftWire_h
@@ -73,14 +73,26 @@ void TwoWire::begin(int address)
   begin((uint8_t)address);
 }
 
-uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+// sets the SCL frequency in Hz (100000 by default), call after begin()
+void TwoWire::setClock(uint32_t frequency)
 {
+  twi_setFrequency(frequency);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop)
+{
+  uint8_t read = 0;
+
   // clamp to buffer length
   if(quantity > BUFFER_LENGTH){
     quantity = BUFFER_LENGTH;
   }
   // perform blocking read into buffer
-  uint8_t read = twi_readFrom(address, rxBuffer, quantity);
+  // without a stop the bus is kept, the next transaction starts with
+  // a repeated start
+  if(quantity && 0 == twi_transfer(address, 0, 0, rxBuffer, quantity, sendStop ? 0 : TWI_NO_STOP)){
+    read = quantity;
+  }
   // set rx buffer iterator vars
   rxBufferIndex = 0;
   rxBufferLength = read;
@@ -88,9 +100,19 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
   return read;
 }
 
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+  return requestFrom(address, quantity, (uint8_t)1);
+}
+
 uint8_t TwoWire::requestFrom(int address, int quantity)
 {
-  return requestFrom((uint8_t)address, (uint8_t)quantity);
+  return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)1);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
+{
+  return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
 }
 
 void TwoWire::beginTransmission(uint8_t address)
@@ -110,9 +132,16 @@ void TwoWire::beginTransmission(int address)
 }
 
 uint8_t TwoWire::endTransmission(void)
+{
+  return endTransmission((uint8_t)1);
+}
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop)
 {
   // transmit buffer (blocking)
-  int8_t ret = twi_writeTo(txAddress, txBuffer, txBufferLength, 1);
+  // without a stop the bus is kept, the next transaction starts with
+  // a repeated start
+  int8_t ret = twi_transfer(txAddress, txBuffer, txBufferLength, 0, 0, sendStop ? 0 : TWI_NO_STOP);
   // reset tx buffer iterator vars
   txBufferIndex = 0;
   txBufferLength = 0;
@@ -212,6 +241,70 @@ void TwoWire::flush(void)
   // to be implemented.
 }
 
+// writes length bytes from buffer to the device at address, without
+// copying them into txBuffer first
+// returns as endTransmission()
+uint8_t TwoWire::writeTo(uint8_t address, const uint8_t *buffer, uint8_t length, uint8_t sendStop)
+{
+  return twi_transfer(address, buffer, length, 0, 0, sendStop ? 0 : TWI_NO_STOP);
+}
+
+// reads length bytes from the device at address straight into buffer
+// returns the number of bytes read
+uint8_t TwoWire::readFrom(uint8_t address, uint8_t *buffer, uint8_t length, uint8_t sendStop)
+{
+  if(0 == length || twi_transfer(address, 0, 0, buffer, length, sendStop ? 0 : TWI_NO_STOP)){
+    return 0;
+  }
+  return length;
+}
+
+// reads length registers starting at reg into buffer
+// the register address is written and the data read back in a single
+// transaction, with a repeated start in between
+// returns the number of bytes read
+uint8_t TwoWire::readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length)
+{
+  if(twi_transfer(address, &reg, 1, buffer, length, 0)){
+    return 0;
+  }
+  return length;
+}
+
+// writes length bytes from buffer to the registers starting at reg
+// the register address goes out as the transaction header, so the data
+// is sent from buffer in place
+// returns as endTransmission()
+uint8_t TwoWire::writeRegisters(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t length)
+{
+  twi_transaction t;
+
+  t.address = address;
+  t.txHeader = &reg;
+  t.txHeaderLength = 1;
+  t.txBuffer = buffer;
+  t.txLength = length;
+  t.rxBuffer = 0;
+  t.rxLength = 0;
+  t.flags = 0;
+  t.callback = 0;
+
+  return twi_run(&t);
+}
+
+// queues a master transaction and returns straight away
+// returns 0 if queued, 1 if the queue is full
+// poll isPending() or set a callback to find out when it is done
+uint8_t TwoWire::enqueue(twi_transaction *transaction)
+{
+  return twi_enqueue(transaction);
+}
+
+uint8_t TwoWire::isPending(const twi_transaction *transaction)
+{
+  return TWI_PENDING == transaction->status;
+}
+
 // behind the scenes function that is called when data is received
 void TwoWire::onReceiveService(uint8_t* inBytes, int numBytes)
 {
@@ -22,7 +22,15 @@
 #include <inttypes.h>
 #include "Stream.h"
 
+extern "C" {
+  #include "utility/twi.h"
+}
+
+// size of the requestFrom()/beginTransmission() buffers, at most 255
+// readFrom(), writeTo() and the register helpers are not limited by it
+#ifndef BUFFER_LENGTH
 #define BUFFER_LENGTH 32
+#endif
 
 class TwoWire : public Stream
 {
@@ -46,11 +54,15 @@ class TwoWire : public Stream
     void begin();
     void begin(uint8_t);
     void begin(int);
+    void setClock(uint32_t);
     void beginTransmission(uint8_t);
     void beginTransmission(int);
     uint8_t endTransmission(void);
+    uint8_t endTransmission(uint8_t);
     uint8_t requestFrom(uint8_t, uint8_t);
+    uint8_t requestFrom(uint8_t, uint8_t, uint8_t);
     uint8_t requestFrom(int, int);
+    uint8_t requestFrom(int, int, int);
     void write(uint8_t);
     void write(int data) { write((uint8_t)data); };
     void write(const char *);
@@ -61,6 +73,18 @@ class TwoWire : public Stream
     void flush(void);
     void onReceive(void (*)(int));
     void onRequest(void (*)(void));
+
+    // blocking transfers straight from and into the caller's arrays
+    uint8_t writeTo(uint8_t, const uint8_t *, uint8_t, uint8_t sendStop = 1);
+    uint8_t readFrom(uint8_t, uint8_t *, uint8_t, uint8_t sendStop = 1);
+
+    // register access for register mapped devices, one transaction each
+    uint8_t readRegisters(uint8_t, uint8_t, uint8_t *, uint8_t);
+    uint8_t writeRegisters(uint8_t, uint8_t, const uint8_t *, uint8_t);
+
+    // non-blocking master transactions, see utility/twi.h
+    uint8_t enqueue(twi_transaction *);
+    uint8_t isPending(const twi_transaction *);
 };
 
 extern TwoWire Wire;
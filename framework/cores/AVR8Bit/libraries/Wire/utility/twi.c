@@ -36,13 +36,22 @@
 
 static volatile uint8_t twi_state;
 static uint8_t twi_slarw;
+static volatile uint8_t twi_inRepStart;
 
 static void (*twi_onSlaveTransmit)(void);
 static void (*twi_onSlaveReceive)(uint8_t*, int);
 
+// master transaction queue, and the transaction on the bus
+static twi_transaction* volatile twi_queue[TWI_QUEUE_LENGTH];
+static volatile uint8_t twi_queueHead;
+static volatile uint8_t twi_queueCount;
+static twi_transaction* volatile twi_current;
+static volatile uint8_t twi_masterIndex;
+static volatile uint8_t twi_masterHeader;
+
+// staging for twi_writeTo() calls that do not wait
 static uint8_t twi_masterBuffer[TWI_BUFFER_LENGTH];
-static volatile uint8_t twi_masterBufferIndex;
-static uint8_t twi_masterBufferLength;
+static twi_transaction twi_masterTransaction;
 
 static uint8_t twi_txBuffer[TWI_BUFFER_LENGTH];
 static volatile uint8_t twi_txBufferIndex;
@@ -51,8 +60,6 @@ static volatile uint8_t twi_txBufferLength;
 static uint8_t twi_rxBuffer[TWI_BUFFER_LENGTH];
 static volatile uint8_t twi_rxBufferIndex;
 
-static volatile uint8_t twi_error;
-
 /* 
  * Function twi_init
  * Desc     readys twi pins and sets twi bitrate
@@ -63,6 +70,7 @@ void twi_init(void)
 {
   // initialize state
   twi_state = TWI_READY;
+  twi_inRepStart = 0;
   
   // TODO let's consider not activate internal pullups for Wire
   pinMode(SDA, INPUT);
@@ -86,19 +94,48 @@ void twi_init(void)
   #endif
 */
   // initialize twi prescaler and bit rate
-  cbi(TWSR, TWPS0);
-  cbi(TWSR, TWPS1);
-  TWBR = ((F_CPU / TWI_FREQ) - 16) / 2;
-
-  /* twi bit rate formula from atmega128 manual pg 204
-  SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
-  note: TWBR should be 10 or higher for master mode
-  It is 72 for a 16mhz Wiring board with 100kHz TWI */
+  twi_setFrequency(TWI_FREQ);
 
   // enable twi module, acks, and twi interrupt
   TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
 }
 
+/* 
+ * Function twi_setFrequency
+ * Desc     sets the twi bit rate and prescaler for the nearest SCL
+ *          frequency not above the one asked for
+ * Input    frequency: SCL frequency in Hz, e.g. 100000, 400000
+ * Output   none
+ */
+void twi_setFrequency(uint32_t frequency)
+{
+  uint32_t divider;
+  uint8_t prescaler = 0;
+
+  if(0 == frequency){
+    return;
+  }
+
+  /* twi bit rate formula from atmega128 manual pg 204
+  SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR * 4^TWPS))
+  note: older parts want TWBR of 10 or higher for master mode
+  It is 72 for a 16mhz Wiring board with 100kHz TWI, 12 for 400kHz */
+  divider = (F_CPU + frequency - 1) / frequency;
+  divider = (divider > 16) ? (divider - 16 + 1) / 2 : 0;
+
+  // only slow clocks (or fast cpus) need the prescaler
+  while(divider > 255 && prescaler < 3){
+    divider = (divider + 3) / 4;
+    ++prescaler;
+  }
+  if(divider > 255){
+    divider = 255;
+  }
+
+  TWSR = (TWSR & ~(_BV(TWPS0) | _BV(TWPS1))) | (prescaler << TWPS0);
+  TWBR = divider;
+}
+
 /* 
  * Function twi_slaveInit
  * Desc     sets slave address and enables interrupt
@@ -111,6 +148,191 @@ void twi_setAddress(uint8_t address)
   TWAR = address << 1;
 }
 
+/* 
+ * Function twi_begin
+ * Desc     takes the next transaction off the queue and sends a start
+ *          condition for it, must be called with interrupts disabled
+ * Input    stop: _BV(TWSTO) to send a stop condition first, or 0 for a
+ *          (repeated) start only
+ * Output   none
+ */
+static void twi_begin(uint8_t stop)
+{
+  twi_transaction* t = twi_queue[twi_queueHead];
+
+  if(++twi_queueHead >= TWI_QUEUE_LENGTH){
+    twi_queueHead = 0;
+  }
+  --twi_queueCount;
+
+  twi_current = t;
+  twi_masterIndex = 0;
+  twi_masterHeader = 1;
+  t->count = 0;
+
+  // build sla+w or sla+r, slave device address + r/w bit
+  if(t->txHeaderLength || t->txLength || !t->rxLength){
+    twi_state = TWI_MTX;
+    twi_slarw = TW_WRITE | (t->address << 1);
+  }else{
+    twi_state = TWI_MRX;
+    twi_slarw = TW_READ | (t->address << 1);
+  }
+
+  if(twi_inRepStart){
+    // the repeated start has been sent already, when the last
+    // transaction ended, so only the address is left to send
+    twi_inRepStart = 0;
+    do{
+      TWDR = twi_slarw;
+    }while(TWCR & _BV(TWWC));
+    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT);
+  }else{
+    // send (stop and) start condition
+    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA) | stop;
+  }
+}
+
+/* 
+ * Function twi_masterDone
+ * Desc     hands the result of the current transaction back, leaves
+ *          the bus alone
+ * Input    status: result for the transaction
+ * Output   none
+ */
+static void twi_masterDone(uint8_t status)
+{
+  twi_transaction* t = twi_current;
+
+  if(!t){
+    return;
+  }
+  twi_current = 0;
+  t->status = status;
+  if(t->callback){
+    t->callback(t);
+  }
+}
+
+/* 
+ * Function twi_masterEnd
+ * Desc     completes the current transaction and chains straight into
+ *          the next queued transaction, if any
+ * Input    status: result for the transaction
+ * Output   none
+ */
+static void twi_masterEnd(uint8_t status)
+{
+  // keep the bus for the next transaction if asked to (and all went well)
+  uint8_t hold = twi_current && 0 == status &&
+                 (twi_current->flags & TWI_NO_STOP);
+
+  twi_masterDone(status);
+
+  if(twi_queueCount){
+    // repeated start, or stop then start in one go
+    twi_begin(hold ? 0 : _BV(TWSTO));
+  }else if(hold){
+    // send the repeated start now, with the interrupt off, and hold the
+    // bus there until the next transaction is queued
+    twi_inRepStart = 1;
+    TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA);
+    twi_state = TWI_READY;
+  }else{
+    twi_stop();
+  }
+}
+
+/* 
+ * Function twi_enqueue
+ * Desc     queues a master transaction and returns at once, the
+ *          transaction starts as soon as the bus is free
+ * Input    t: transaction, must not already be pending
+ * Output   0 .. queued
+ *          1 .. queue full
+ */
+uint8_t twi_enqueue(twi_transaction* t)
+{
+  uint8_t oldSREG = SREG;
+  uint8_t tail;
+
+  cli();
+  if(twi_queueCount >= TWI_QUEUE_LENGTH){
+    SREG = oldSREG;
+    return 1;
+  }
+
+  t->status = TWI_PENDING;
+  tail = twi_queueHead + twi_queueCount;
+  if(tail >= TWI_QUEUE_LENGTH){
+    tail -= TWI_QUEUE_LENGTH;
+  }
+  twi_queue[tail] = t;
+  ++twi_queueCount;
+
+  // become master right away if nothing else is going on
+  if(TWI_READY == twi_state){
+    twi_begin(0);
+  }
+
+  SREG = oldSREG;
+  return 0;
+}
+
+/* 
+ * Function twi_run
+ * Desc     queues a transaction and waits for it to finish
+ * Input    t: transaction
+ * Output   transaction status
+ */
+uint8_t twi_run(twi_transaction* t)
+{
+  // wait for room in the queue
+  while(twi_enqueue(t)){
+    continue;
+  }
+  // wait for the transaction to complete
+  while(TWI_PENDING == t->status){
+    continue;
+  }
+  return t->status;
+}
+
+/* 
+ * Function twi_transfer
+ * Desc     attempts to become twi bus master, write a series of bytes
+ *          to a device and read a series of bytes back in a single
+ *          transaction, using a repeated start in between
+ * Input    address: 7bit i2c device address
+ *          txData: pointer to byte array to send
+ *          txLength: number of bytes to send (may be 0)
+ *          rxData: pointer to byte array to read into
+ *          rxLength: number of bytes to read (may be 0)
+ *          flags: TWI_NO_STOP to keep the bus for the next transaction
+ * Output   0 .. success
+ *          2 .. address send, NACK received
+ *          3 .. data send, NACK received
+ *          4 .. other twi error (lost bus arbitration, bus error, ..)
+ */
+uint8_t twi_transfer(uint8_t address, const uint8_t* txData, uint8_t txLength,
+                     uint8_t* rxData, uint8_t rxLength, uint8_t flags)
+{
+  twi_transaction t;
+
+  // transfer straight from and into the caller's arrays
+  t.address = address;
+  t.txHeader = 0;
+  t.txHeaderLength = 0;
+  t.txBuffer = txData;
+  t.txLength = txLength;
+  t.rxBuffer = rxData;
+  t.rxLength = rxLength;
+  t.flags = flags;
+  t.callback = 0;
+
+  return twi_run(&t);
+}
+
 /* 
  * Function twi_readFrom
  * Desc     attempts to become twi bus master and read a
@@ -122,50 +344,12 @@ void twi_setAddress(uint8_t address)
  */
 uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length)
 {
-  uint8_t i;
-
-  // ensure data will fit into buffer
-  if(TWI_BUFFER_LENGTH < length){
+  if(0 == length){
     return 0;
   }
-
-  // wait until twi is ready, become master receiver
-  while(TWI_READY != twi_state){
-    continue;
-  }
-  twi_state = TWI_MRX;
-  // reset error state (0xFF.. no error occured)
-  twi_error = 0xFF;
-
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length-1;  // This is not intuitive, read on...
-  // On receive, the previously configured ACK/NACK setting is transmitted in
-  // response to the received byte before the interrupt is signalled. 
-  // Therefor we must actually set NACK when the _next_ to last byte is
-  // received, causing that NACK to be sent in response to receiving the last
-  // expected byte of data.
-
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_READ;
-  twi_slarw |= address << 1;
-
-  // send start condition
-  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
-
-  // wait for read operation to complete
-  while(TWI_MRX == twi_state){
-    continue;
-  }
-
-  if (twi_masterBufferIndex < length)
-    length = twi_masterBufferIndex;
-
-  // copy twi buffer to data
-  for(i = 0; i < length; ++i){
-    data[i] = twi_masterBuffer[i];
+  if(twi_transfer(address, 0, 0, data, length, 0)){
+    return 0;
   }
-	
   return length;
 }
 
@@ -187,48 +371,40 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
 {
   uint8_t i;
 
+  if(wait){
+    return twi_transfer(address, data, length, 0, 0, 0);
+  }
+
+  // not waiting, so the data has to be staged
   // ensure data will fit into buffer
   if(TWI_BUFFER_LENGTH < length){
     return 1;
   }
 
-  // wait until twi is ready, become master transmitter
-  while(TWI_READY != twi_state){
+  // wait until the previous staged write is done
+  while(TWI_PENDING == twi_masterTransaction.status){
     continue;
   }
-  twi_state = TWI_MTX;
-  // reset error state (0xFF.. no error occured)
-  twi_error = 0xFF;
 
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length;
-  
   // copy data to twi buffer
   for(i = 0; i < length; ++i){
     twi_masterBuffer[i] = data[i];
   }
-  
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_WRITE;
-  twi_slarw |= address << 1;
-  
-  // send start condition
-  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
 
-  // wait for write operation to complete
-  while(wait && (TWI_MTX == twi_state)){
+  twi_masterTransaction.address = address;
+  twi_masterTransaction.txHeader = 0;
+  twi_masterTransaction.txHeaderLength = 0;
+  twi_masterTransaction.txBuffer = twi_masterBuffer;
+  twi_masterTransaction.txLength = length;
+  twi_masterTransaction.rxBuffer = 0;
+  twi_masterTransaction.rxLength = 0;
+  twi_masterTransaction.flags = 0;
+  twi_masterTransaction.callback = 0;
+
+  while(twi_enqueue(&twi_masterTransaction)){
     continue;
   }
-  
-  if (twi_error == 0xFF)
-    return 0;	// success
-  else if (twi_error == TW_MT_SLA_NACK)
-    return 2;	// error: address send, nack received
-  else if (twi_error == TW_MT_DATA_NACK)
-    return 3;	// error: data send, nack received
-  else
-    return 4;	// other twi error
+  return 0;
 }
 
 /* 
@@ -352,35 +528,54 @@ SIGNAL(TWI_vect)
     // Master Transmitter
     case TW_MT_SLA_ACK:  // slave receiver acked address
     case TW_MT_DATA_ACK: // slave receiver acked data
-      // if there is data to send, send it, otherwise stop 
-      if(twi_masterBufferIndex < twi_masterBufferLength){
+      // send the header first, then the data, then read or stop
+      if(twi_masterHeader){
+        if(twi_masterIndex < twi_current->txHeaderLength){
+          TWDR = twi_current->txHeader[twi_masterIndex++];
+          twi_reply(1);
+          break;
+        }
+        twi_masterHeader = 0;
+        twi_masterIndex = 0;
+      }
+      if(twi_masterIndex < twi_current->txLength){
         // copy data to output register and ack
-        TWDR = twi_masterBuffer[twi_masterBufferIndex++];
+        TWDR = twi_current->txBuffer[twi_masterIndex++];
         twi_reply(1);
+      }else if(twi_current->rxLength){
+        // switch to reading: repeated start, without giving up the bus
+        twi_state = TWI_MRX;
+        twi_masterIndex = 0;
+        twi_slarw = TW_READ | (twi_current->address << 1);
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
       }else{
-        twi_stop();
+        twi_masterEnd(0);
       }
       break;
     case TW_MT_SLA_NACK:  // address sent, nack received
-      twi_error = TW_MT_SLA_NACK;
-      twi_stop();
+      twi_masterEnd(2);
       break;
     case TW_MT_DATA_NACK: // data sent, nack received
-      twi_error = TW_MT_DATA_NACK;
-      twi_stop();
+      twi_masterEnd(3);
       break;
     case TW_MT_ARB_LOST: // lost bus arbitration
-      twi_error = TW_MT_ARB_LOST;
+      twi_masterDone(4);
       twi_releaseBus();
+      // try the next one once the bus is free
+      if(twi_queueCount){
+        twi_begin(0);
+      }
       break;
 
     // Master Receiver
     case TW_MR_DATA_ACK: // data received, ack sent
       // put byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
+      twi_current->rxBuffer[twi_masterIndex++] = TWDR;
     case TW_MR_SLA_ACK:  // address sent, ack received
       // ack if more bytes are expected, otherwise nack
-      if(twi_masterBufferIndex < twi_masterBufferLength){
+      // On receive, the ACK/NACK set here is transmitted in response to
+      // the _next_ byte, so NACK once the next byte is the last one.
+      if(twi_masterIndex + 1 < twi_current->rxLength){
         twi_reply(1);
       }else{
         twi_reply(0);
@@ -388,9 +583,12 @@ SIGNAL(TWI_vect)
       break;
     case TW_MR_DATA_NACK: // data received, nack sent
       // put final byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
+      twi_current->rxBuffer[twi_masterIndex++] = TWDR;
+      twi_current->count = twi_masterIndex;
+      twi_masterEnd(0);
+      break;
     case TW_MR_SLA_NACK: // address sent, nack received
-      twi_stop();
+      twi_masterEnd(2);
       break;
     // TW_MR_ARB_LOST handled by TW_MT_ARB_LOST case
 
@@ -399,6 +597,8 @@ SIGNAL(TWI_vect)
     case TW_SR_GCALL_ACK: // addressed generally, returned ack
     case TW_SR_ARB_LOST_SLA_ACK:   // lost arbitration, returned ack
     case TW_SR_ARB_LOST_GCALL_ACK: // lost arbitration, returned ack
+      // a master transaction in progress has lost the bus
+      twi_masterDone(4);
       // enter slave receiver mode
       twi_state = TWI_SRX;
       // indicate that rx buffer can be overwritten and ack
@@ -430,6 +630,10 @@ SIGNAL(TWI_vect)
       twi_rxBufferIndex = 0;
       // ack future responses and leave slave receiver state
       twi_releaseBus();
+      // start any master transaction queued meanwhile
+      if(twi_queueCount){
+        twi_begin(0);
+      }
       break;
     case TW_SR_DATA_NACK:       // data received, returned nack
     case TW_SR_GCALL_DATA_NACK: // data received generally, returned nack
@@ -440,6 +644,8 @@ SIGNAL(TWI_vect)
     // Slave Transmitter
     case TW_ST_SLA_ACK:          // addressed, returned ack
     case TW_ST_ARB_LOST_SLA_ACK: // arbitration lost, returned ack
+      // a master transaction in progress has lost the bus
+      twi_masterDone(4);
       // enter slave transmitter mode
       twi_state = TWI_STX;
       // ready the tx buffer index for iteration
@@ -471,14 +677,17 @@ SIGNAL(TWI_vect)
       twi_reply(1);
       // leave slave receiver state
       twi_state = TWI_READY;
+      // start any master transaction queued meanwhile
+      if(twi_queueCount){
+        twi_begin(0);
+      }
       break;
 
     // All
     case TW_NO_INFO:   // no state information
       break;
     case TW_BUS_ERROR: // bus error, illegal stop/start
-      twi_error = TW_BUS_ERROR;
-      twi_stop();
+      twi_masterEnd(4);
       break;
   }
 }
@@ -27,20 +27,60 @@
   #define TWI_FREQ 100000L
   #endif
 
+  // slave buffers and staging for twi_writeTo() without wait, at most
+  // 255; master transfers with twi_transfer() or a twi_transaction use
+  // the caller's arrays and are not limited by it
   #ifndef TWI_BUFFER_LENGTH
   #define TWI_BUFFER_LENGTH 32
   #endif
 
+  #ifndef TWI_QUEUE_LENGTH
+  #define TWI_QUEUE_LENGTH 4
+  #endif
+
   #define TWI_READY 0
   #define TWI_MRX   1
   #define TWI_MTX   2
   #define TWI_SRX   3
   #define TWI_STX   4
-  
+
+  // twi_transaction status while it is queued or on the bus, afterwards
+  // it holds the result: 0 success, 2 address NACK, 3 data NACK, 4 other
+  #define TWI_PENDING 0xFF
+
+  // twi_transaction flags
+  #define TWI_NO_STOP 0x01  // end with a repeated start, keeping the bus
+
+  // A master transaction: write txHeaderLength bytes from txHeader and
+  // txLength bytes from txBuffer, then read rxLength bytes into rxBuffer
+  // (any of them may be 0), with a repeated start in between.  The
+  // header lets a register or memory address go out in front of the
+  // data without copying both into one array.  The buffers are used
+  // in place, so they and the transaction itself must stay valid until
+  // status is no longer TWI_PENDING.  callback, if set, is called from
+  // the TWI interrupt once the transaction is done.
+  typedef struct twi_transaction {
+    uint8_t address;
+    const uint8_t* txHeader;
+    uint8_t txHeaderLength;
+    const uint8_t* txBuffer;
+    uint8_t txLength;
+    uint8_t* rxBuffer;
+    uint8_t rxLength;
+    uint8_t flags;
+    volatile uint8_t status;
+    volatile uint8_t count;   // bytes actually read
+    void (*callback)(struct twi_transaction*);
+  } twi_transaction;
+
   void twi_init(void);
+  void twi_setFrequency(uint32_t);
   void twi_setAddress(uint8_t);
   uint8_t twi_readFrom(uint8_t, uint8_t*, uint8_t);
   uint8_t twi_writeTo(uint8_t, uint8_t*, uint8_t, uint8_t);
+  uint8_t twi_transfer(uint8_t, const uint8_t*, uint8_t, uint8_t*, uint8_t, uint8_t);
+  uint8_t twi_enqueue(twi_transaction*);
+  uint8_t twi_run(twi_transaction*);
   uint8_t twi_transmit(const uint8_t*, uint8_t);
   void twi_attachSlaveRxEvent( void (*)(uint8_t*, int) );
   void twi_attachSlaveTxEvent( void (*)(void) );
@@ -32,6 +32,7 @@ class FIFO : public Countable<T>
     T dequeue();                            // get next element
     bool enqueue(T element);                // add an element
     T peek() const;                         // get the next element without releasing it from the FIFO
+    void removeLast(unsigned int elements); // take back the most recently added elements
     void flush();                           // reset to default state
 
     //how many elements are currently in the FIFO?
@@ -94,6 +95,17 @@ T FIFO<T, rawSize>::peek() const
   return raw[nextOut];
 }
 
+template<typename T, int rawSize>
+void FIFO<T, rawSize>::removeLast(unsigned int elements)
+{
+  if (elements > count())
+    elements = count();
+  numberOfElements -= elements;
+  nextIn -= elements;
+  if (nextIn < 0) // wrap back if needed
+    nextIn += rawSize;
+}
+
 template<typename T, int rawSize>
 void FIFO<T, rawSize>::flush()
 {
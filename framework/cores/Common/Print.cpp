@@ -17,9 +17,42 @@
 */
 
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
 #include "Print.h"
 
 
+// Digits for the power of two bases, kept in flash
+static const char digitTable[] PROGMEM = "0123456789ABCDEF";
+
+static const unsigned long powersOf10[] PROGMEM =
+{
+  1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL,
+  1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+#define MAX_DECIMALS 9
+
+// n / 10 by multiply and shift, no software division needed
+// (Hacker's Delight, divu10).  Leaves the quotient in n, returns n % 10.
+static inline uint8_t divmod10(unsigned long &n)
+{
+  unsigned long q = (n >> 1) + (n >> 2);
+  q += q >> 4;
+  q += q >> 8;
+  q += q >> 16;
+  q >>= 3;
+  uint8_t r = n - (((q << 2) + q) << 1);
+  if (r > 9)
+  {
+    q++;
+    r -= 10;
+  }
+  n = q;
+  return r;
+}
+
+
 /*
 || @description
 || | Virtual method - may be redefined in derived class (polymorphic)
@@ -29,8 +62,7 @@
 
 void Print::write(const char *str)
 {
-  while (*str)
-    write(*str++);
+  write((const uint8_t *)str, strlen(str));
 }
 
 /*
@@ -78,11 +110,9 @@ void Print::print(long n, int base)
   {
     // why must this only be in base 10?
     if (n < 0)
-    {
-      print('-');
-      n = -n;
-    }
-    printNumber(n, 10);
+      printNumber(0UL - (unsigned long)n, 10, true);
+    else
+      printNumber(n, 10);
   }
   else
   {
@@ -116,6 +146,63 @@ void Print::print(double n, int digits)
 }
 
 
+/*
+|| @description
+|| | Formatted output, the format string in RAM or in flash (Constant()).
+|| | Only a small subset of printf() is supported, see printFormatted().
+|| | Output is collected and handed over to write() in blocks.
+|| #
+*/
+
+void Print::printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  printFormatted(format, args, false);
+  va_end(args);
+}
+
+void Print::printf(const __ConstantStringHelper *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  printFormatted((const char *)format, args, true);
+  va_end(args);
+}
+
+
+// Fixed point, value scaled by 10^decimals: printFixed(-1234, 2) -> "-12.34"
+void Print::printFixed(long value, uint8_t decimals)
+{
+  if (value < 0)
+    printDecimal(0, 0UL - (unsigned long)value, decimals, true);
+  else
+    printDecimal(0, value, decimals, false);
+}
+
+// Binary fixed point (Q format) with fracBits fractional bits, shown
+// with 'digits' decimals: printBinaryFixed(0x0180, 8) -> "1.50"
+void Print::printBinaryFixed(long value, uint8_t fracBits, uint8_t digits)
+{
+  boolean negative = value < 0;
+  unsigned long magnitude = negative ? 0UL - (unsigned long)value : value;
+
+  if (fracBits > 31)
+    fracBits = 31;
+  if (digits > MAX_DECIMALS)
+    digits = MAX_DECIMALS;
+
+  unsigned long intPart = magnitude >> fracBits;
+  unsigned long fraction = magnitude & ((1UL << fracBits) - 1);
+
+  // scale the binary fraction to decimals, rounding to nearest
+  fraction = ((uint64_t)fraction * pgm_read_dword(&powersOf10[digits]) +
+              ((1ULL << fracBits) >> 1)) >> fracBits;
+
+  printDecimal(intPart, fraction, digits, negative);
+}
+
+
 void Print::print(const Printable &p)
 {
   p.printTo(*this);
@@ -135,8 +222,7 @@ void Print::print(const __ConstantStringHelper *cs)
 
 void Print::println(void)
 {
-  print('\r');
-  print('\n');
+  write((const uint8_t *)"\r\n", 2);
 }
 
 
@@ -205,83 +291,359 @@ void Print::println(const __ConstantStringHelper *cs)
 
 // private methods
 
-void Print::printNumber(unsigned long n, uint8_t base)
+// Builds the digits of n right to left, ending just before 'end'.
+// Returns a pointer to the first digit.
+static char *formatNumber(char *end, unsigned long n, uint8_t base)
 {
-  /* BH: new version to be implemented
-    uint8_t buf[sizeof(char) * sizeof(int32_t)];
-    uint32_t i = 0;
+  char *p = end;
 
-    if (n == 0)
-    {
-      write('0');
-      return;
-    }
+  switch (base)
+  {
+    case 10:
+      do
+        *--p = '0' + divmod10(n);
+      while (n);
+      break;
+
+    case 16:
+      do
+      {
+        *--p = pgm_read_byte(&digitTable[n & 0x0F]);
+        n >>= 4;
+      }
+      while (n);
+      break;
+
+    case 8:
+      do
+      {
+        *--p = '0' + (n & 0x07);
+        n >>= 3;
+      }
+      while (n);
+      break;
+
+    case 2:
+      do
+      {
+        *--p = '0' + (n & 0x01);
+        n >>= 1;
+      }
+      while (n);
+      break;
+
+    default:
+      do
+      {
+        uint8_t digit = n % base;
+        n /= base;
+        *--p = (digit < 10 ? '0' + digit : 'A' + digit - 10);
+      }
+      while (n);
+      break;
+  }
 
-    while (n > 0)
-    {
-      buf[i++] = n % base;
-      n /= base;
-    }
+  return p;
+}
+
+void Print::printNumber(unsigned long n, uint8_t base, boolean negative)
+{
+  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars, plus sign.
+  char *end = buf + sizeof(buf);
 
-    for (; i > 0; i--)
-      write((buf[i - 1] < 10 ?
-            '0' + buf[i - 1] :
-            'A' + buf[i - 1] - 10));
-  */
+  if (base < 2)
+    base = 10;
 
-  unsigned char buf[8 * sizeof(long)]; // Assumes 8-bit chars.
-  unsigned long i = 0;
+  char *p = formatNumber(end, n, base);
+  if (negative)
+    *--p = '-';
 
-  if (n == 0)
-  {
-    print('0');
-    return;
-  }
+  // hand the whole number over in one go
+  write((const uint8_t *)p, end - p);
+}
+
+// Size of a buffer that can hold any formatDecimal()/formatFloat() result
+#define DECIMAL_BUFFER_SIZE (8 * sizeof(long) + MAX_DECIMALS + 2) // digits, '.' and sign
+
+// Builds intPart + fraction / 10^digits with exactly 'digits' decimals,
+// right to left, ending just before 'end'.  fraction may be larger than
+// 10^digits; the excess carries into the integer part.
+static char *formatDecimal(char *end, unsigned long intPart,
+                           unsigned long fraction, uint8_t digits)
+{
+  char *p = end;
 
-  while (n > 0)
+  if (digits > MAX_DECIMALS)
+    digits = MAX_DECIMALS;
+
+  if (digits > 0)
   {
-    buf[i++] = n % base;
-    n /= base;
+    for (uint8_t i = 0; i < digits; i++)
+      *--p = '0' + divmod10(fraction);
+    *--p = '.';
   }
 
-  for (; i > 0; i--)
-    print((char)(buf[i - 1] < 10 ?
-                 '0' + buf[i - 1] :
-                 'A' + buf[i - 1] - 10));
+  return formatNumber(p, intPart + fraction, 10);
 }
 
-void Print::printFloat(double number, uint8_t digits)
+static char *formatFloat(char *end, double number, uint8_t digits)
 {
-  // Handle negative numbers
-  if (number < 0.0)
+  char *p;
+
+  if (isnan(number))
   {
-    print('-');
+    p = end - 3;
+    memcpy_P(p, PSTR("nan"), 3);
+    return p;
+  }
+
+  boolean negative = number < 0.0;
+  if (negative)
     number = -number;
+
+  if (isinf(number) || number > 4294967040.0)
+  {
+    // does not fit the integer part
+    p = end - 3;
+    memcpy_P(p, isinf(number) ? PSTR("inf") : PSTR("ovf"), 3);
   }
+  else
+  {
+    if (digits > MAX_DECIMALS)
+      digits = MAX_DECIMALS;
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i = 0; i < digits; ++i)
-    rounding /= 10.0;
+    // Convert once to scaled integers; rounding the fraction so that
+    // print(1.999, 2) prints as "2.00" (the carry is taken care of by
+    // formatDecimal).
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    unsigned long fraction = (unsigned long)(remainder * pgm_read_dword(&powersOf10[digits]) + 0.5);
 
-  number += rounding;
+    p = formatDecimal(end, intPart, fraction, digits);
+  }
 
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  print(int_part);
+  if (negative)
+    *--p = '-';
+  return p;
+}
 
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0)
-    print(".");
+void Print::printDecimal(unsigned long intPart, unsigned long fraction,
+                         uint8_t digits, boolean negative)
+{
+  char buf[DECIMAL_BUFFER_SIZE];
+  char *end = buf + sizeof(buf);
+
+  char *p = formatDecimal(end, intPart, fraction, digits);
+  if (negative)
+    *--p = '-';
+
+  write((const uint8_t *)p, end - p);
+}
+
+void Print::printFloat(double number, uint8_t digits)
+{
+  char buf[DECIMAL_BUFFER_SIZE];
+  char *end = buf + sizeof(buf);
+
+  char *p = formatFloat(end, number, digits);
+
+  write((const uint8_t *)p, end - p);
+}
+
+
+// Collects formatted output and hands it to write() in chunks
+class FormatOutput
+{
+  public:
+    FormatOutput(Print &out) : _out(out), _length(0) {}
+
+    void put(char c)
+    {
+      if (_length == sizeof(_buffer))
+        flush();
+      _buffer[_length++] = c;
+    }
+    void put(const char *str, size_t size)
+    {
+      while (size--)
+        put(*str++);
+    }
+    void fill(char c, int count)
+    {
+      while (count-- > 0)
+        put(c);
+    }
+    void flush()
+    {
+      if (_length)
+        _out.write((const uint8_t *)_buffer, _length);
+      _length = 0;
+    }
 
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
+  private:
+    Print &_out;
+    uint8_t _length;
+    char _buffer[32];
+};
+
+// A small printf() - single pass over the format, no vfprintf().
+//
+// Supports %d %i %u %x %X %o %c %s %f %%, the 'l' length modifier,
+// the '-' and '0' flags, a field width and a precision (%f decimals,
+// default 6, or the maximum %s length).
+void Print::printFormatted(const char *format, va_list args, boolean constant)
+{
+  FormatOutput out(*this);
+  char buf[DECIMAL_BUFFER_SIZE];
+  char *end = buf + sizeof(buf);
+  char c;
+
+#define NEXT_FORMAT_CHAR() (constant ? pgm_read_byte(format++) : *format++)
+
+  while ((c = NEXT_FORMAT_CHAR()))
   {
-    remainder *= 10.0;
-    int toPrint = int(remainder);
-    print(toPrint);
-    remainder -= toPrint;
+    if (c != '%')
+    {
+      out.put(c);
+      continue;
+    }
+
+    boolean leftAlign = false;
+    char padding = ' ';
+    int width = 0;
+    int precision = -1;
+    boolean isLong = false;
+
+    // flags
+    for (;;)
+    {
+      c = NEXT_FORMAT_CHAR();
+      if (c == '-')
+        leftAlign = true;
+      else if (c == '0')
+        padding = '0';
+      else
+        break;
+    }
+    if (leftAlign)
+      padding = ' ';
+
+    // width and precision
+    while (isdigit(c))
+    {
+      width = width * 10 + (c - '0');
+      c = NEXT_FORMAT_CHAR();
+    }
+    if (c == '.')
+    {
+      precision = 0;
+      c = NEXT_FORMAT_CHAR();
+      while (isdigit(c))
+      {
+        precision = precision * 10 + (c - '0');
+        c = NEXT_FORMAT_CHAR();
+      }
+    }
+
+    // length
+    while (c == 'l' || c == 'h')
+    {
+      if (c == 'l')
+        isLong = true;
+      c = NEXT_FORMAT_CHAR();
+    }
+
+    const char *p = end;
+    size_t length;
+    boolean negative = false;
+
+    switch (c)
+    {
+      case 'd':
+      case 'i':
+      {
+        long n = isLong ? va_arg(args, long) : va_arg(args, int);
+        negative = n < 0;
+        p = formatNumber(end, negative ? 0UL - (unsigned long)n : n, 10);
+        break;
+      }
+
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+      {
+        unsigned long n = isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+        p = formatNumber(end, n, c == 'u' ? 10 : c == 'o' ? 8 : 16);
+        if (c == 'x')
+        {
+          for (char *q = (char *)p; q != end; q++)
+            *q = tolower(*q);
+        }
+        break;
+      }
+
+      case 'c':
+        buf[0] = va_arg(args, int);
+        p = buf;
+        end = buf + 1;
+        break;
+
+      case 's':
+        p = va_arg(args, const char *);
+        if (!p)
+          p = "(null)";
+        length = strlen(p);
+        if (precision >= 0 && (size_t)precision < length)
+          length = precision;
+        end = (char *)p + length;
+        break;
+
+      case 'f':
+      {
+        double n = va_arg(args, double);
+        p = formatFloat(end, n, precision < 0 ? 6 : precision);
+        if (*p == '-')
+        {
+          negative = true;
+          p++;
+        }
+        break;
+      }
+
+      case '%':
+        out.put('%');
+        continue;
+
+      case '\0':
+        // format ends within a conversion
+        format--;
+        continue;
+
+      default:
+        // unknown conversion, print as is
+        out.put('%');
+        out.put(c);
+        continue;
+    }
+
+    length = end - p;
+    width -= length + negative;
+
+    if (negative && padding == '0')
+      out.put('-');
+    if (!leftAlign)
+      out.fill(padding, width);
+    if (negative && padding != '0')
+      out.put('-');
+    out.put(p, length);
+    if (leftAlign)
+      out.fill(' ', width);
+
+    end = buf + sizeof(buf);
   }
-}
 
+#undef NEXT_FORMAT_CHAR
+
+  out.flush();
+}
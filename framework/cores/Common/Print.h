@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 #include "WConstants.h"
 #include "WString.h"
@@ -51,6 +52,15 @@ class Print
     void print(int, int = DEC);
     void print(double, int = 2);
 
+    // fixed point - no floating point code involved
+    void printFixed(long value, uint8_t decimals);
+    void printBinaryFixed(long value, uint8_t fracBits, uint8_t digits = 2);
+
+    // formatted output
+    // use ConstantFormat() to keep a format in flash and have it checked
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void printf(const __ConstantStringHelper *format, ...);
+
     void print(const Printable &p);
     void print(const __ConstantStringHelper *cs);
 
@@ -71,8 +81,10 @@ class Print
     void println(const __ConstantStringHelper *cs);
 
   private:
-    void printNumber(unsigned long, uint8_t);
+    void printNumber(unsigned long, uint8_t, boolean = false);
     void printFloat(double, uint8_t);
+    void printDecimal(unsigned long, unsigned long, uint8_t, boolean);
+    void printFormatted(const char *, va_list, boolean);
 };
 
 #endif  // __cplusplus
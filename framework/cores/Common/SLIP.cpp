@@ -0,0 +1,137 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | SLIP (RFC 1055) packet framing over any Stream.
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include "SLIP.h"
+
+
+SLIP::SLIP(Stream &stream, uint8_t *buffer, size_t size) :
+  _stream(&stream), _buffer(buffer), _size(size)
+{
+  flush();
+}
+
+
+void SLIP::flush()
+{
+  _length = 0;
+  _escape = false;
+  _overflow = false;
+  _complete = false;
+}
+
+
+size_t SLIP::receive()
+{
+  // the last packet has been seen, make room for the next one
+  if (_complete)
+    flush();
+
+  while (_stream->available() > 0)
+  {
+    uint8_t c = _stream->read();
+
+    if (c == SLIP_END)
+    {
+      // empty packets (back to back END bytes) are skipped
+      if (_length && !_overflow)
+      {
+        _complete = true;
+        return _length;
+      }
+      flush();
+      continue;
+    }
+
+    if (c == SLIP_ESC)
+    {
+      _escape = true;
+      continue;
+    }
+
+    if (_escape)
+    {
+      // anything else after ESC is a protocol violation, RFC 1055
+      // says to keep the byte as it is
+      if (c == SLIP_ESC_END)
+        c = SLIP_END;
+      else if (c == SLIP_ESC_ESC)
+        c = SLIP_ESC;
+      _escape = false;
+    }
+
+    if (_length < _size)
+      _buffer[_length++] = c;
+    else
+      _overflow = true;
+  }
+  return 0;
+}
+
+
+void SLIP::send(const uint8_t *data, size_t length)
+{
+  beginPacket();
+  write(data, length);
+  endPacket();
+}
+
+
+// a leading END flushes any line noise the receiver has collected
+void SLIP::beginPacket()
+{
+  _stream->write(SLIP_END);
+}
+
+
+void SLIP::endPacket()
+{
+  _stream->write(SLIP_END);
+}
+
+
+void SLIP::write(uint8_t c)
+{
+  writeEscaped(*_stream, &c, 1);
+}
+
+
+void SLIP::write(const uint8_t *buffer, size_t size)
+{
+  writeEscaped(*_stream, buffer, size);
+}
+
+
+void SLIP::writeEscaped(Print &output, const uint8_t *data, size_t length)
+{
+  static const uint8_t escapeEnd[2] = { SLIP_ESC, SLIP_ESC_END };
+  static const uint8_t escapeEsc[2] = { SLIP_ESC, SLIP_ESC_ESC };
+  const uint8_t *run = data;
+  const uint8_t *end = data + length;
+
+  // bytes that need no escaping go out in runs with a single write()
+  while (data != end)
+  {
+    if (*data == SLIP_END || *data == SLIP_ESC)
+    {
+      if (data != run)
+        output.write(run, data - run);
+      output.write(*data == SLIP_END ? escapeEnd : escapeEsc, 2);
+      run = data + 1;
+    }
+    data++;
+  }
+  if (data != run)
+    output.write(run, data - run);
+}
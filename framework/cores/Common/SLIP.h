@@ -0,0 +1,111 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | SLIP (RFC 1055) packet framing over any Stream.
+|| |
+|| | Packets are delimited by END bytes, END and ESC inside a packet are
+|| | escaped.  receive() takes bytes off the stream as they arrive and
+|| | only reports a packet once its closing END was seen, so the
+|| | application never looks at partial data.  Line noise costs at most
+|| | the packet it hit: the next END starts over.
+|| |
+|| | SLIP wraps a caller provided receive buffer, SLIPBuffer<N> carries
+|| | its own storage for packets of up to N bytes.  Packets are sent with
+|| | send(), or with beginPacket(), print()/write() and endPacket().
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @example
+|| | SLIPBuffer<64> slip(Serial);
+|| |
+|| | if (slip.receive())
+|| |   handle(slip.packet(), slip.length());
+|| |
+|| | slip.send(data, sizeof(data));
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef SLIP_H
+#define SLIP_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "WConstants.h"
+#include "Stream.h"
+
+#define SLIP_END      0xC0
+#define SLIP_ESC      0xDB
+#define SLIP_ESC_END  0xDC
+#define SLIP_ESC_ESC  0xDD
+
+class SLIP : public Print
+{
+  public:
+    SLIP(Stream &stream, uint8_t *buffer, size_t size);
+
+    // Read what the stream has and return the length of a complete
+    // packet, 0 if there is none yet.  The packet stays valid until the
+    // next call.  Packets longer than the buffer are dropped.
+    size_t receive();
+    const uint8_t *packet() const
+    {
+      return _buffer;
+    }
+    size_t length() const
+    {
+      return _complete ? _length : 0;
+    }
+    // forget a partially received packet
+    void flush();
+
+    // send a whole packet
+    void send(const uint8_t *data, size_t length);
+
+    // or build one with write()/print() calls in between
+    void beginPacket();
+    void endPacket();
+    void write(uint8_t);
+    void write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str)
+
+    // escape a packet body onto any Print, for senders that frame their
+    // own packets: SLIP_END, the body, SLIP_END
+    static void writeEscaped(Print &output, const uint8_t *data, size_t length);
+
+  private:
+    Stream *_stream;
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _length;
+    boolean _escape;
+    boolean _overflow;
+    boolean _complete;
+};
+
+template <size_t N>
+class SLIPBuffer : public SLIP
+{
+  public:
+    SLIPBuffer(Stream &stream) : SLIP(stream, _storage, N) {}
+
+  private:
+    // the base class points into _storage, so copies are not allowed
+    SLIPBuffer(const SLIPBuffer &);
+    SLIPBuffer &operator = (const SLIPBuffer &);
+
+    uint8_t _storage[N];
+};
+
+#endif  // __cplusplus
+#endif
+// SLIP_H
@@ -0,0 +1,80 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Fixed size, heap free text buffers that can be printed to.
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <string.h>
+#include "StringBuilder.h"
+
+
+PrintBuffer::PrintBuffer(char *buffer, size_t size) :
+  _buffer(buffer), _size(size)
+{
+  // no room even for the '\0': use an empty string of our own instead,
+  // so every write overflows and the caller's buffer is never touched
+  if (_size == 0)
+  {
+    static char empty[1];
+    _buffer = empty;
+    _size = 1;
+  }
+  reset();
+}
+
+
+void PrintBuffer::reset()
+{
+  _length = 0;
+  _overflow = false;
+  _buffer[0] = '\0';
+}
+
+
+void PrintBuffer::write(uint8_t c)
+{
+  if (_length < _size - 1)
+  {
+    _buffer[_length++] = c;
+    _buffer[_length] = '\0';
+  }
+  else
+    _overflow = true;
+}
+
+
+void PrintBuffer::write(const char *str)
+{
+  write((const uint8_t *)str, strlen(str));
+}
+
+
+void PrintBuffer::write(const uint8_t *buffer, size_t size)
+{
+  size_t room = _size - 1 - _length;
+
+  if (size > room)
+  {
+    size = room;
+    _overflow = true;
+  }
+
+  memcpy(_buffer + _length, buffer, size);
+  _length += size;
+  _buffer[_length] = '\0';
+}
+
+
+void PrintBuffer::printTo(Print &p) const
+{
+  p.write((const uint8_t *)_buffer, _length);
+}
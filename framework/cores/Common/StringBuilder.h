@@ -0,0 +1,104 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Fixed size, heap free text buffers that can be printed to.
+|| |
+|| | PrintBuffer wraps a caller provided char array, StringBuilder<N>
+|| | carries its own storage for N characters.  Both accept every
+|| | print()/println() overload, are always NUL terminated, and flag
+|| | truncation instead of allocating more memory.
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @example
+|| | StringBuilder<32> line;
+|| |
+|| | line.print("T=");
+|| | line.print(temperature, 1);
+|| | line.print(",H=");
+|| | line.println(humidity);
+|| | if (!line.overflow())
+|| |   Serial.print(line);    // sent with a single write(buffer, size)
+|| | line.reset();
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef STRINGBUILDER_H
+#define STRINGBUILDER_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Print.h"
+#include "Printable.h"
+
+class PrintBuffer : public Print, public Printable
+{
+  public:
+    // size is the full size of buffer, including room for the '\0';
+    // with a size of 0 buffer is not used and everything overflows
+    PrintBuffer(char *buffer, size_t size);
+
+    void write(uint8_t);
+    void write(const char *str);
+    void write(const uint8_t *buffer, size_t size);
+
+    const char *c_str() const
+    {
+      return _buffer;
+    }
+    size_t length() const
+    {
+      return _length;
+    }
+    size_t capacity() const
+    {
+      return _size - 1;
+    }
+    size_t remaining() const
+    {
+      return _size - 1 - _length;
+    }
+    // true if anything was dropped since the last reset()
+    boolean overflow() const
+    {
+      return _overflow;
+    }
+    void reset();
+
+    // Printable - hands the whole buffer over in one write()
+    void printTo(Print &p) const;
+
+  private:
+    char *_buffer;
+    size_t _size;
+    size_t _length;
+    boolean _overflow;
+};
+
+template <size_t N>
+class StringBuilder : public PrintBuffer
+{
+  public:
+    StringBuilder() : PrintBuffer(_storage, N + 1) {}
+
+  private:
+    // the base class points into _storage, so copies are not allowed
+    StringBuilder(const StringBuilder &);
+    StringBuilder &operator = (const StringBuilder &);
+
+    char _storage[N + 1];
+};
+
+#endif  // __cplusplus
+#endif
+// STRINGBUILDER_H
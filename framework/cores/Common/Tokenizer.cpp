@@ -0,0 +1,218 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Zero copy string tokenizer and allocation free number parsers.
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <ctype.h>
+#include <limits.h>
+#include "Tokenizer.h"
+
+
+Tokenizer::Tokenizer(const char *str, int delim) :
+  _start(str), _end(NULL), _delim(delim)
+{
+  reset();
+}
+
+Tokenizer::Tokenizer(const char *str, size_t length, int delim) :
+  _start(str), _end(str + length), _delim(delim)
+{
+  reset();
+}
+
+Tokenizer::Tokenizer(const String &str, int delim) :
+  _delim(delim)
+{
+  if (str.buffer)
+  {
+    _start = str.buffer;
+    _end = str.buffer + str.len;
+  }
+  else
+  {
+    _start = _end = "";
+  }
+  reset();
+}
+
+
+void Tokenizer::reset()
+{
+  _position = _start;
+  _token = _start;
+  _tokenLength = 0;
+  _done = false;
+}
+
+
+boolean Tokenizer::next()
+{
+  if (_done)
+    return false;
+
+  const char *p = _position;
+
+  // single pass: stop at the delimiter, the given end, or a '\0'
+  while (p != _end && *p && *p != _delim)
+    p++;
+
+  _token = _position;
+  _tokenLength = p - _position;
+
+  if (p == _end || !*p)
+    _done = true;
+  else
+    _position = p + 1;
+
+  return true;
+}
+
+
+long Tokenizer::toLong() const
+{
+  long value;
+  parseFixed(_token, _tokenLength, 0, value);
+  return value;
+}
+
+long Tokenizer::toFixed(uint8_t decimals) const
+{
+  long value;
+  parseFixed(_token, _tokenLength, decimals, value);
+  return value;
+}
+
+
+// result * 10 + digit, false if that would go past limit
+static boolean addDigit(unsigned long &result, uint8_t digit, unsigned long limit)
+{
+  if (result > (limit - digit) / 10)
+    return false;
+  result = result * 10 + digit;
+  return true;
+}
+
+
+boolean parseFixed(const char *str, size_t length, uint8_t decimals, long &value)
+{
+  const char *end = str + length;
+  unsigned long result = 0;
+  unsigned long limit;
+  boolean negative = false;
+  boolean digits = false;
+
+  value = 0;
+
+  while (str != end && isspace(*str))
+    str++;
+  while (end != str && isspace(end[-1]))
+    end--;
+
+  if (str != end && (*str == '-' || *str == '+'))
+    negative = (*str++ == '-');
+  // the magnitude of LONG_MIN is one more than LONG_MAX
+  limit = negative ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+
+  // integer part
+  while (str != end && isdigit(*str))
+  {
+    if (!addDigit(result, *str++ - '0', limit))
+      return false;
+    digits = true;
+  }
+
+  // fractional part - keep 'decimals' digits, drop the rest
+  if (str != end && *str == '.')
+  {
+    str++;
+    while (str != end && isdigit(*str))
+    {
+      if (decimals)
+      {
+        if (!addDigit(result, *str - '0', limit))
+          return false;
+        decimals--;
+      }
+      str++;
+      digits = true;
+    }
+  }
+
+  // pad the scale if fewer fractional digits were given
+  while (decimals--)
+    if (!addDigit(result, 0, limit))
+      return false;
+
+  if (!digits || str != end)
+    return false;
+
+  // LONG_MIN has no positive counterpart, so negate one less
+  value = (negative && result) ? -(long)(result - 1) - 1 : (long)result;
+  return true;
+}
+
+
+static int splitFields(Tokenizer &fields, long *splits, int maxSplits, uint8_t decimals)
+{
+  int count = 0;
+
+  while (fields.next())
+  {
+    if (count < maxSplits)
+      parseFixed(fields.token(), fields.length(), decimals, splits[count]);
+    count++;
+  }
+  return count;
+}
+
+static int splitFields(Tokenizer &fields, int *splits, int maxSplits)
+{
+  int count = 0;
+  long value;
+
+  while (fields.next())
+  {
+    if (count < maxSplits)
+    {
+      parseFixed(fields.token(), fields.length(), 0, value);
+      splits[count] = value;
+    }
+    count++;
+  }
+  return count;
+}
+
+
+int splitString(const char *what, int delim, long *splits, int maxSplits, uint8_t decimals)
+{
+  Tokenizer fields(what, delim);
+  return splitFields(fields, splits, maxSplits, decimals);
+}
+
+int splitString(const char *what, int delim, int *splits, int maxSplits)
+{
+  Tokenizer fields(what, delim);
+  return splitFields(fields, splits, maxSplits);
+}
+
+int splitString(const String &what, int delim, long *splits, int maxSplits, uint8_t decimals)
+{
+  Tokenizer fields(what, delim);
+  return splitFields(fields, splits, maxSplits, decimals);
+}
+
+int splitString(const String &what, int delim, int *splits, int maxSplits)
+{
+  Tokenizer fields(what, delim);
+  return splitFields(fields, splits, maxSplits);
+}
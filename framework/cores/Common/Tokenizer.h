@@ -0,0 +1,98 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Zero copy string tokenizer and allocation free number parsers.
+|| |
+|| | A Tokenizer walks a char array (or String) in place and hands out
+|| | each field as a pointer and a length into the original text.
+|| | Nothing is copied and nothing is allocated, so it is safe to use
+|| | on long input lines and from tight loops.
+|| |
+|| | Wiring Common API
+|| #
+||
+|| @example
+|| | long values[20];
+|| | int n = splitString("1240,87000,10,30,20,1200", ',', values, 20);
+|| |
+|| | Tokenizer fields(line, ',');
+|| | while (fields.next())
+|| |   Serial.write((const uint8_t *)fields.token(), fields.length());
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "WConstants.h"
+#include "WString.h"
+
+class Tokenizer
+{
+  public:
+    // str must stay valid (and unchanged) while the Tokenizer is used
+    Tokenizer(const char *str, int delim);
+    Tokenizer(const char *str, size_t length, int delim);
+    Tokenizer(const String &str, int delim);
+
+    // advance to the next field, false once the input is used up
+    boolean next();
+    // start over from the first field
+    void reset();
+
+    // current field - NOT NUL terminated
+    const char *token() const
+    {
+      return _token;
+    }
+    size_t length() const
+    {
+      return _tokenLength;
+    }
+
+    // current field as a number (0 if it does not hold one)
+    long toLong() const;
+    long toFixed(uint8_t decimals) const;
+
+  private:
+    const char *_start;
+    const char *_end;       // NULL if the input is NUL terminated
+    const char *_position;
+    const char *_token;
+    size_t _tokenLength;
+    char _delim;
+    boolean _done;
+};
+
+// Parse length chars at str as a fixed point number scaled by
+// 10^decimals ("12.345", 2 -> 1234); further fractional digits are
+// truncated.  Leading and trailing blanks are skipped.  Return true if
+// the text was a well formed number that fits a long.
+boolean parseFixed(const char *str, size_t length, uint8_t decimals, long &value);
+inline boolean parseLong(const char *str, size_t length, long &value)
+{
+  return parseFixed(str, length, 0, value);
+}
+
+// Split what at every delim and parse the fields into splits[].
+// At most maxSplits values are stored; the total number of fields is
+// returned.  Fields that are not numbers are stored as 0.
+int splitString(const char *what, int delim, long *splits, int maxSplits, uint8_t decimals = 0);
+int splitString(const char *what, int delim, int *splits, int maxSplits);
+int splitString(const String &what, int delim, long *splits, int maxSplits, uint8_t decimals = 0);
+int splitString(const String &what, int delim, int *splits, int maxSplits);
+
+#endif  // __cplusplus
+#endif
+// TOKENIZER_H
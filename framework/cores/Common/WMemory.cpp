@@ -15,6 +15,7 @@
 ||
 */
 
+#include <ctype.h>
 #include <Wiring.h>
 
 void * operator new(size_t size)
@@ -52,38 +53,41 @@ void __cxa_guard_abort(__guard *) {};
 void __cxa_pure_virtual(void) {};
 
 
+// The Vector versions are kept for compatibility.  They no longer build
+// a temporary String per field - see Tokenizer.h for the allocation free
+// array versions.  Like the atol() they used before, they take the
+// number at the start of a field and ignore what follows, "12abc" is 12
+// and "1.5" is 1.
+
+// length of the leading whitespace, sign and digits of a field
+static size_t numberPrefix(const char *str, size_t length)
+{
+  size_t i = 0;
+
+  while (i < length && isspace(str[i]))
+    i++;
+  if (i < length && (str[i] == '-' || str[i] == '+'))
+    i++;
+  while (i < length && isdigit(str[i]))
+    i++;
+  return i;
+}
+
 int splitString(String &what, int delim,  Vector<long> &splits)
 {
   what.trim();
   splits.removeAllElements();
-  const char *chars = what.buffer;
-  int splitCount = 0; //1;
-  for (int i = 0; i < what.length(); i++)
-  {
-    if (chars[i] == delim) splitCount++;
-  }
-  if (splitCount == 0)
-  {
-    splits.addElement(atol(what.buffer));
-    return 1;
-  }
 
-  int pieceCount = splitCount + 1;
+  Tokenizer fields(what, delim);
+  long value;
 
-  int splitIndex = 0;
-  int startIndex = 0;
-  for (int i = 0; i < what.length(); i++)
+  while (fields.next())
   {
-    if (chars[i] == delim)
-    {
-      splits.addElement(atol(what.substring(startIndex, i).buffer));
-      splitIndex++;
-      startIndex = i + 1;
-    }
+    parseLong(fields.token(), numberPrefix(fields.token(), fields.length()), value);
+    splits.addElement(value);
   }
-  splits.addElement(atol(what.substring(startIndex, what.length()).buffer));
 
-  return pieceCount;
+  return splits.size();
 }
 
 
@@ -91,33 +95,15 @@ int splitString(String &what, int delim,  Vector<int> &splits)
 {
   what.trim();
   splits.removeAllElements();
-  const char *chars = what.buffer;
-  int splitCount = 0; //1;
-  for (int i = 0; i < what.length(); i++)
-  {
-    if (chars[i] == delim) splitCount++;
-  }
-  if (splitCount == 0)
-  {
-    splits.addElement(atoi(what.buffer));
-    return(1);
-  }
 
-  int pieceCount = splitCount + 1;
+  Tokenizer fields(what, delim);
+  long value;
 
-  int splitIndex = 0;
-  int startIndex = 0;
-  for (int i = 0; i < what.length(); i++)
+  while (fields.next())
   {
-    if (chars[i] == delim)
-    {
-      splits.addElement(atoi(what.substring(startIndex, i).buffer));
-      splitIndex++;
-      startIndex = i + 1;
-    }
+    parseLong(fields.token(), numberPrefix(fields.token(), fields.length()), value);
+    splits.addElement(value);
   }
-  splits.addElement(atoi(what.substring(startIndex, what.length()).buffer));
 
-  return pieceCount;
+  return splits.size();
 }
-
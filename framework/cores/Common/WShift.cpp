@@ -17,39 +17,60 @@
 
 #include <Wiring.h>
 
-uint16_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t count, uint8_t delayTime)
+uint16_t _shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t count, uint8_t delayTime)
 {
   uint16_t value = 0;
+  uint16_t mask = (bitOrder == LSBFIRST) ? 1 : (1 << (count - 1));
 
-  for (uint8_t i = 0; i < count; ++i)
+  while (count--)
   {
     digitalWrite(clockPin, HIGH);
-    delayMicroseconds(delayTime);
+    if (delayTime)
+      delayMicroseconds(delayTime);
+    if (digitalRead(dataPin))
+      value |= mask;
+    digitalWrite(clockPin, LOW);
+    if (delayTime)
+      delayMicroseconds(delayTime);
     if (bitOrder == LSBFIRST)
-      value |= digitalRead(dataPin) << i;
+      mask <<= 1;
     else
-      value |= digitalRead(dataPin) << ((count - 1) - i);
-    digitalWrite(clockPin, LOW);
-    delayMicroseconds(delayTime);
+      mask >>= 1;
   }
   return value;
 }
 
 
-void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint16_t val, uint8_t count, uint8_t delayTime)
+void _shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint16_t val, uint8_t count, uint8_t delayTime)
 {
-  int i;
+  uint16_t mask = (bitOrder == LSBFIRST) ? 1 : (1 << (count - 1));
 
-  for (i = 0; i < count; ++i)
+  while (count--)
   {
-    if (bitOrder == LSBFIRST)
-      digitalWrite(dataPin, !!(val & (1 << i)));
-    else
-      digitalWrite(dataPin, !!(val & (1 << ((count - 1) - i))));
-
+    digitalWrite(dataPin, (val & mask) ? HIGH : LOW);
     digitalWrite(clockPin, HIGH);
-    delayMicroseconds(delayTime);
+    if (delayTime)
+      delayMicroseconds(delayTime);
     digitalWrite(clockPin, LOW);
-    delayMicroseconds(delayTime);
+    if (delayTime)
+      delayMicroseconds(delayTime);
+    if (bitOrder == LSBFIRST)
+      mask <<= 1;
+    else
+      mask >>= 1;
   }
 }
+
+
+void _shiftInBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buffer, size_t length)
+{
+  while (length--)
+    *buffer++ = _shiftIn(dataPin, clockPin, bitOrder, 8, 0);
+}
+
+
+void _shiftOutBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buffer, size_t length)
+{
+  while (length--)
+    _shiftOut(dataPin, clockPin, bitOrder, *buffer++, 8, 0);
+}
@@ -19,9 +19,101 @@
 #define WSHIFT_H
 
 #include <stdint.h>
+#include <stddef.h>
 
-uint16_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t count = 8, uint8_t delayTime = 1);
-void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint16_t value, uint8_t count = 8, uint8_t delayTime = 1);
+// Out of line versions, used when the pins are not known at compile time
+uint16_t _shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t count, uint8_t delayTime);
+void _shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint16_t value, uint8_t count, uint8_t delayTime);
+void _shiftInBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buffer, size_t length);
+void _shiftOutBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buffer, size_t length);
+
+// With constant pins the bit loops below use the constant pin paths of
+// pinWrite()/pinRead(), which come down to single port instructions.
+
+static inline uint16_t shiftIn(uint8_t, uint8_t, uint8_t, uint8_t = 8, uint8_t = 1) __attribute__((always_inline, unused));
+static inline uint16_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t count, uint8_t delayTime)
+{
+  if (__builtin_constant_p(dataPin) && __builtin_constant_p(clockPin))
+  {
+    uint16_t value = 0;
+    uint16_t mask = (bitOrder == LSBFIRST) ? 1 : (1 << (count - 1));
+
+    while (count--)
+    {
+      pinWrite(clockPin, HIGH);
+      if (delayTime)
+        delayMicroseconds(delayTime);
+      if (pinRead(dataPin))
+        value |= mask;
+      pinWrite(clockPin, LOW);
+      if (delayTime)
+        delayMicroseconds(delayTime);
+      if (bitOrder == LSBFIRST)
+        mask <<= 1;
+      else
+        mask >>= 1;
+    }
+    return value;
+  }
+  else
+    return _shiftIn(dataPin, clockPin, bitOrder, count, delayTime);
+}
+
+static inline void shiftOut(uint8_t, uint8_t, uint8_t, uint16_t, uint8_t = 8, uint8_t = 1) __attribute__((always_inline, unused));
+static inline void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint16_t value, uint8_t count, uint8_t delayTime)
+{
+  if (__builtin_constant_p(dataPin) && __builtin_constant_p(clockPin))
+  {
+    uint16_t mask = (bitOrder == LSBFIRST) ? 1 : (1 << (count - 1));
+
+    while (count--)
+    {
+      if (value & mask)
+        pinWrite(dataPin, HIGH);
+      else
+        pinWrite(dataPin, LOW);
+      pinWrite(clockPin, HIGH);
+      if (delayTime)
+        delayMicroseconds(delayTime);
+      pinWrite(clockPin, LOW);
+      if (delayTime)
+        delayMicroseconds(delayTime);
+      if (bitOrder == LSBFIRST)
+        mask <<= 1;
+      else
+        mask >>= 1;
+    }
+  }
+  else
+    _shiftOut(dataPin, clockPin, bitOrder, value, count, delayTime);
+}
+
+// Shift a byte array through a chain of cascaded shift registers
+// (74HC595 out, 74HC165 in) in one call, at full speed.  buffer[0] is
+// shifted first, so it ends up in the register farthest down the chain.
+// Latching is left to the caller.  On the hardware SPI pins,
+// SPI.write(buffer, length) and SPI.transfer(0, buffer, length) do the
+// same at up to F_CPU / 2.
+
+static inline void shiftOutBytes(uint8_t, uint8_t, uint8_t, const uint8_t *, size_t) __attribute__((always_inline, unused));
+static inline void shiftOutBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buffer, size_t length)
+{
+  if (__builtin_constant_p(dataPin) && __builtin_constant_p(clockPin))
+    while (length--)
+      shiftOut(dataPin, clockPin, bitOrder, *buffer++, 8, 0);
+  else
+    _shiftOutBytes(dataPin, clockPin, bitOrder, buffer, length);
+}
+
+static inline void shiftInBytes(uint8_t, uint8_t, uint8_t, uint8_t *, size_t) __attribute__((always_inline, unused));
+static inline void shiftInBytes(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buffer, size_t length)
+{
+  if (__builtin_constant_p(dataPin) && __builtin_constant_p(clockPin))
+    while (length--)
+      *buffer++ = shiftIn(dataPin, clockPin, bitOrder, 8, 0);
+  else
+    _shiftInBytes(dataPin, clockPin, bitOrder, buffer, length);
+}
 
 #endif
 // WSHIFT_H
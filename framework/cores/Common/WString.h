@@ -221,6 +221,7 @@ class String : public Printable
 
     friend int splitString(String &what, int delim, Vector<long> &splits);
     friend int splitString(String &what, int delim, Vector<int> &splits);
+    friend class Tokenizer;
 
     void printTo(Print &p) const;
 
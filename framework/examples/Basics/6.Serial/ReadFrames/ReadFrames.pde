@@ -0,0 +1,42 @@
+/**
+ * Read Frames
+ *
+ * Let the serial port collect whole lines in the background and
+ * handle them one at a time.  Send "on" or "off", ended with a
+ * newline, to switch the onboard LED.
+ * For the Wiring boards v1 the on-board LED is on pin 48,
+ * on Wiring S the on-board LED is on pin 15.
+ *
+ * Lines have to fit the receive buffer (RX_BUFFER_SIZE bytes),
+ * longer ones are dropped.
+ */
+
+uint8_t line[RX_BUFFER_SIZE];
+
+void setup()
+{
+  Serial.begin(9600);
+  // a frame ends with a newline
+  Serial.setFraming(FRAME_DELIMITER, '\n');
+  pinMode(WLED, OUTPUT);
+}
+
+void loop()
+{
+  while (Serial.availableFrames())
+  {
+    int length = Serial.readFrame(line, sizeof(line));
+
+    // drop the newline, and the carriage return some terminals send
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+      length--;
+
+    if (length == 2 && line[0] == 'o' && line[1] == 'n')
+      digitalWrite(WLED, HIGH);
+    else if (length == 3 && line[0] == 'o' && line[1] == 'f' && line[2] == 'f')
+      digitalWrite(WLED, LOW);
+  }
+
+  // the rest of loop() can take as long as it needs
+  delay(100);
+}
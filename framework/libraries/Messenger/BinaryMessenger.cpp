@@ -0,0 +1,399 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | BinaryMessenger is the binary counterpart of Messenger.
+|| | Frames are 0x00, COBS(payload, CRC16) and 0x00 again.  The CRC is
+|| | CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) of the
+|| | payload, sent low byte first like every other field.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <string.h>
+
+#include <Wiring.h>
+#include "BinaryMessenger.h"
+
+// CRC-16/CCITT a byte at a time, without a table
+static uint16_t crc16(const uint8_t *data, uint8_t length)
+{
+  uint16_t crc = 0xFFFF;
+
+  while (length--)
+  {
+    crc = (crc >> 8) | (crc << 8);
+    crc ^= *data++;
+    crc ^= (crc & 0xFF) >> 4;
+    crc ^= crc << 12;
+    crc ^= (crc & 0xFF) << 5;
+  }
+  return crc;
+}
+
+/*
+|| @constructor
+|| | Initializes the BinaryMessenger to initial state
+|| #
+||
+|| @parameter output Where send() writes the frames, usually the serial port that is read
+*/
+BinaryMessenger::BinaryMessenger(Print &output)
+{
+  this->output = &output;
+  callback = NULL;
+  messageState = 0;
+  text = 0;
+  resync = 0;
+  bufferIndex = 0;
+  readIndex = 0;
+  beginMessage();
+}
+
+/*
+|| @description
+|| | Feed one received byte to the decoder.
+|| | Once a frame with a good CRC is complete its fields can be read
+|| | until the next frame starts.
+|| #
+||
+|| @return True if a message has been completed
+*/
+uint8_t BinaryMessenger::process(int serialByte)
+{
+  text = 0;
+  if (serialByte < 0) return 0;
+
+  if (messageState != 1)
+  {
+    // a 0x00 opens a frame, anything else belongs to the text protocol
+    if (serialByte == 0) startFrame();
+    else text = 1;
+    // after a line end the next zero surely opens a frame
+    if (serialByte == '\r' || serialByte == '\n') resync = 0;
+    return 0;
+  }
+
+  if (serialByte == 0)
+  {
+    // back to back zeros: the first one closed nothing, so a frame
+    // surely starts here
+    if (bufferIndex == 0 && code == 0)
+    {
+      resync = 0;
+      return 0;
+    }
+
+    if (remaining == 0 && !overflow && bufferIndex >= 2 &&
+        crc16(buffer, bufferIndex - 2) == (buffer[bufferIndex - 2] | (buffer[bufferIndex - 1] << 8)))
+    {
+      bufferIndex -= 2;
+      readIndex = 0;
+      messageState = 2;
+      resync = 0;
+      if (callback != NULL) (*callback)();
+      return 1;
+    }
+    // a bad frame may have been text seen as a frame, so this zero
+    // is taken as the start of the next one to get back in step
+    resync = 1;
+    startFrame();
+    return 0;
+  }
+
+  // until frames are in step again, a line end means the "frame" was
+  // text; that line is lost, the ones after it reach Messenger again
+  if (resync && (serialByte == '\r' || serialByte == '\n'))
+  {
+    messageState = 0;
+    resync = 0;
+    text = 1;
+    return 0;
+  }
+
+  if (remaining == 0)
+  {
+    // a code byte: every block but a full one ended with a zero
+    if (code != 0 && code != 0xFF) store(0);
+    code = serialByte;
+    remaining = code - 1;
+  }
+  else
+  {
+    store(serialByte);
+    remaining--;
+  }
+
+  // too long for a frame, what follows up to the next zero is text
+  if (overflow)
+  {
+    resync = 1;
+    messageState = 0;
+  }
+  return 0;
+}
+
+/*
+|| @description
+|| | Check if the last byte given to process() was outside of any frame,
+|| | such bytes can be passed on to a text Messenger
+|| #
+||
+|| @return True if the last byte was not part of a binary frame
+*/
+uint8_t BinaryMessenger::isText()
+{
+  return text;
+}
+
+/*
+|| @description
+|| | Get the number of message bytes not read yet
+|| #
+||
+|| @return The number of bytes left, 0 when there is no message
+*/
+uint8_t BinaryMessenger::available()
+{
+  return (messageState == 2) ? bufferIndex - readIndex : 0;
+}
+
+/*
+|| @description
+|| | Return the next byte of the message
+|| #
+||
+|| @return The byte, 0 if the message is used up
+*/
+uint8_t BinaryMessenger::readByte()
+{
+  const uint8_t *p = next(1);
+  return p ? p[0] : 0;
+}
+
+/*
+|| @description
+|| | Return the next two bytes of the message as a little-endian int
+|| #
+||
+|| @return The int, 0 if the message is used up
+*/
+int BinaryMessenger::readInt()
+{
+  const uint8_t *p = next(2);
+  return p ? (int16_t)(p[0] | (p[1] << 8)) : 0;
+}
+
+/*
+|| @description
+|| | Return the next four bytes of the message as a little-endian long
+|| #
+||
+|| @return The long, 0 if the message is used up
+*/
+long BinaryMessenger::readLong()
+{
+  const uint8_t *p = next(4);
+  if (p == NULL) return 0;
+  return (int32_t)(p[0] | ((uint16_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/*
+|| @description
+|| | Return the next four bytes of the message as a float
+|| #
+||
+|| @return The float, 0 if the message is used up
+*/
+float BinaryMessenger::readFloat()
+{
+  union
+  {
+    uint32_t i;
+    float f;
+  } value;
+
+  value.i = readLong();
+  return value.f;
+}
+
+/*
+|| @description
+|| | Skip size bytes of the message and return where they are in the
+|| | frame buffer, for arrays or structures the caller reads in place
+|| #
+||
+|| @return Pointer to the bytes, NULL if fewer are left
+*/
+const uint8_t *BinaryMessenger::readBytes(uint8_t size)
+{
+  return next(size);
+}
+
+/*
+|| @description
+|| | Attaches a callback function that is executed once a message is completed.
+|| #
+||
+|| @parameter newFunction The callback that gets called when a mesage is received
+*/
+void BinaryMessenger::attach(messengerCallbackFunction newFunction)
+{
+  callback = newFunction;
+}
+
+/*
+|| @description
+|| | Start building a new message, drops what was written since the last send()
+|| #
+*/
+void BinaryMessenger::beginMessage()
+{
+  messageLength = 0;
+  messageOverflow = 0;
+}
+
+void BinaryMessenger::writeByte(uint8_t value)
+{
+  uint8_t *p = reserve(1);
+  if (p) p[0] = value;
+}
+
+void BinaryMessenger::writeInt(int value)
+{
+  uint8_t *p = reserve(2);
+  if (p)
+  {
+    p[0] = value;
+    p[1] = value >> 8;
+  }
+}
+
+void BinaryMessenger::writeLong(long value)
+{
+  uint8_t *p = reserve(4);
+  if (p)
+  {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+  }
+}
+
+void BinaryMessenger::writeFloat(float value)
+{
+  union
+  {
+    float f;
+    uint32_t i;
+  } bits;
+
+  bits.f = value;
+  writeLong(bits.i);
+}
+
+void BinaryMessenger::writeBytes(const uint8_t *data, uint8_t size)
+{
+  uint8_t *p = reserve(size);
+  if (p) memcpy(p, data, size);
+}
+
+/*
+|| @description
+|| | Make room for size bytes in the message and return where they are,
+|| | so the caller can fill them in place
+|| #
+||
+|| @return Pointer into the message, NULL if it would not fit
+*/
+uint8_t *BinaryMessenger::reserve(uint8_t size)
+{
+  uint8_t *p;
+
+  // keep room for the CRC
+  if (messageOverflow || size > BINARY_MESSENGER_BUFFER_SIZE - 2 - messageLength)
+  {
+    messageOverflow = 1;
+    return NULL;
+  }
+  p = message + messageLength;
+  messageLength += size;
+  return p;
+}
+
+/*
+|| @description
+|| | Send the message built since beginMessage() as one frame and start a new one
+|| #
+||
+|| @return True if sent, false if the message did not fit the buffer
+*/
+uint8_t BinaryMessenger::send()
+{
+  const uint8_t *p = message;
+  const uint8_t *end;
+  uint16_t crc;
+
+  if (messageOverflow)
+  {
+    beginMessage();
+    return 0;
+  }
+  crc = crc16(message, messageLength);
+  message[messageLength++] = crc;
+  message[messageLength++] = crc >> 8;
+  end = message + messageLength;
+
+  output->write((uint8_t)0);
+  for (;;)
+  {
+    // each block is a code byte and up to 254 bytes without a zero
+    const uint8_t *block = p;
+    while (p != end && *p != 0 && p - block < 254) p++;
+    uint8_t length = p - block;
+    output->write((uint8_t)(length + 1));
+    if (length) output->write(block, length);
+    if (p == end) break;
+    // the zero that ended the block is implied by its code
+    if (length < 254) p++;
+  }
+  output->write((uint8_t)0);
+
+  beginMessage();
+  return 1;
+}
+
+/// private methods
+
+void BinaryMessenger::startFrame()
+{
+  messageState = 1;
+  code = 0;
+  remaining = 0;
+  overflow = 0;
+  bufferIndex = 0;
+  readIndex = 0;
+}
+
+void BinaryMessenger::store(uint8_t value)
+{
+  if (bufferIndex < BINARY_MESSENGER_BUFFER_SIZE) buffer[bufferIndex++] = value;
+  else overflow = 1;
+}
+
+const uint8_t *BinaryMessenger::next(uint8_t size)
+{
+  const uint8_t *p;
+
+  if (available() < size) return NULL;
+  p = buffer + readIndex;
+  readIndex += size;
+  return p;
+}
@@ -0,0 +1,93 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | BinaryMessenger is the binary counterpart of Messenger.
+|| | Messages are sent as raw little-endian fields followed by a CRC16,
+|| | COBS encoded so that 0x00 never occurs inside, and framed by a
+|| | 0x00 byte on each side.  Fields are read and written in place in the
+|| | frame buffer, there is no text conversion at all.
+|| |
+|| | Text never contains 0x00, so binary frames and Messenger text can
+|| | share one stream: feed every byte to BinaryMessenger first and pass
+|| | it on to Messenger when isText() says it was not part of a frame.
+|| |
+|| | After a frame with a bad CRC its closing zero is taken as the next
+|| | opening one.  Until a good frame or two zeros in a row come in, a CR
+|| | or LF inside a frame ends it as text, so a glitch costs the current
+|| | text line and not every one after it.  Frames too long for the buffer
+|| | are dropped and their rest is passed on as text.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef BINARYMESSENGER_H
+#define BINARYMESSENGER_H
+
+// payload plus the two CRC bytes
+#define BINARY_MESSENGER_BUFFER_SIZE 64
+
+#include <inttypes.h>
+#include <Print.h>
+
+class BinaryMessenger
+{
+  public:
+    typedef void (*messengerCallbackFunction)(void);
+
+    BinaryMessenger(Print &output);
+
+    uint8_t process(int serialByte);
+    uint8_t isText();
+    uint8_t available();
+
+    uint8_t readByte();
+    int readInt();
+    long readLong();
+    float readFloat();
+    const uint8_t *readBytes(uint8_t size);
+
+    void attach(messengerCallbackFunction newFunction);
+
+    void beginMessage();
+    void writeByte(uint8_t value);
+    void writeInt(int value);
+    void writeLong(long value);
+    void writeFloat(float value);
+    void writeBytes(const uint8_t *data, uint8_t size);
+    uint8_t *reserve(uint8_t size);
+    uint8_t send();
+
+  private:
+    void startFrame();
+    void store(uint8_t value);
+    const uint8_t *next(uint8_t size);
+
+    Print *output;
+
+    uint8_t messageState; // 0 waiting for a frame, 1 in a frame, 2 message complete
+    uint8_t text; // the last byte was not part of a frame
+    uint8_t resync; // frames may be out of step, text may be taken for one
+    uint8_t code; // COBS code of the current block
+    uint8_t remaining; // bytes left in the current block
+    uint8_t overflow;
+
+    uint8_t buffer[BINARY_MESSENGER_BUFFER_SIZE]; // Decoded frame being received
+    uint8_t bufferIndex; // Index where to write the data
+    uint8_t readIndex; // Index of the next field to read
+
+    uint8_t message[BINARY_MESSENGER_BUFFER_SIZE]; // Message being built
+    uint8_t messageLength;
+    uint8_t messageOverflow;
+
+    messengerCallbackFunction callback;
+};
+
+#endif
+// BINARYMESSENGER_H
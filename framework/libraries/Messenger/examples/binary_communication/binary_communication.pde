@@ -0,0 +1,73 @@
+/**
+ * Binary Communication
+ *
+ * Text messages and binary frames on the same serial port.
+ * Text messages are handled by Messenger as usual:
+ *
+ * w d [pin] [value] -> write digital pin
+ *
+ * Binary frames carry a command byte followed by its fields:
+ *
+ * 'a' -> answered with 'a' and the eight analog inputs as ints
+ * 'w' [pin byte] [value int] -> write analog pin
+ *
+ * End text lines with CR or LF: after a corrupted binary frame that is
+ * what hands the port back to text, and only the line being received
+ * when it happened is lost.
+ */
+
+#include <Messenger.h>
+#include <BinaryMessenger.h>
+
+Messenger message = Messenger();
+BinaryMessenger binary = BinaryMessenger(Serial);
+
+void messageCompleted()
+{
+  if (message.checkString("w") && message.checkString("d"))
+  {
+    int pin = message.readInt();
+    int state = message.readInt();
+    digitalWrite(pin, state);
+  }
+}
+
+void binaryCompleted()
+{
+  switch (binary.readByte())
+  {
+    case 'a':
+      binary.beginMessage();
+      binary.writeByte('a');
+      for (uint8_t i = 0; i < 8; i++)
+        binary.writeInt(analogRead(i));
+      binary.send();
+      break;
+    case 'w':
+    {
+      uint8_t pin = binary.readByte();
+      int value = binary.readInt();
+      analogWrite(pin, value);
+      break;
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  message.attach(messageCompleted);
+  binary.attach(binaryCompleted);
+}
+
+void loop()
+{
+  while (Serial.available())
+  {
+    int c = Serial.read();
+    // bytes outside of binary frames are text
+    binary.process(c);
+    if (binary.isText())
+      message.process(c);
+  }
+}
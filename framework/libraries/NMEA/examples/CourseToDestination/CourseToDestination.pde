@@ -16,8 +16,7 @@ NMEA gps(GPRMC);  // GPS data connection to GPRMC sentence type
 float d;          // relative direction to destination
 
 // destination coordinates in degrees-decimal
-float dest_latitude = 48.858342;
-float dest_longitude = 2.294522;
+Waypoint destination(48.858342, 2.294522);
 
 void setup() {
   Serial1.begin(4800);
@@ -35,7 +34,7 @@ void loop() {
       // check if GPS positioning was active
       if (gps.gprmc_status() == 'A') {
         // calculate relative direction to destination
-        d = gps.gprmc_course_to(dest_latitude, dest_longitude) - gps.gprmc_course();
+        d = gps.gprmc_course_to(destination) - gps.gprmc_course();
         if (d < 0) { d += 360; }
         if (d > 180) { d -= 360; }
         // set LEDs accordingly
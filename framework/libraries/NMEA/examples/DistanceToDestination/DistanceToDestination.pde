@@ -14,9 +14,9 @@
 
 NMEA gps(GPRMC);  // GPS data connection to GPRMC sentence type
 
-// destination coordinates in degrees-decimal
-float dest_latitude = 48.858342;
-float dest_longitude = 2.294522;
+// destination coordinates in degrees-decimal; the waypoint computes
+// its trigonometry once, not on every distance calculation
+Waypoint destination(48.858342, 2.294522);
 
 void setup() {
   Serial1.begin(4800);
@@ -32,8 +32,9 @@ void loop() {
     if (gps.decode(c)) {
       // check if GPS positioning was active
       if (gps.gprmc_status() == 'A') {
-        // read distance to destination in meters and set led accordingly
-        if (gps.gprmc_distance_to(dest_latitude, dest_longitude, MTR) < 500.0) {
+        // read distance to destination in meters and set led accordingly;
+        // the flat approximation is plenty at this range
+        if (gps.gprmc_distance_to(destination, MTR, EQUIRECTANGULAR) < 500.0) {
           digitalWrite(8, HIGH);
         } else {
           digitalWrite(8, LOW);
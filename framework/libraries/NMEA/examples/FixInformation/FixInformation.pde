@@ -0,0 +1,41 @@
+/**
+ * This example illustates the fixed-point terms of the
+ * NMEA library. It assumes that a GPS receiver is connected
+ * to serial port 'Serial1' at 4800 bps.
+ *
+ * GGA and GSA sentences of any talker are decoded without
+ * floating point math; the quality of the fix is printed
+ * whenever a GGA sentence completes.
+ */
+
+#include <nmea.h>
+
+NMEA gps(ALL);    // GPS data connection to all sentence types
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(4800);
+}
+
+void loop() {
+  while (Serial1.available() > 0) {
+    // read incoming character from GPS and feed it to NMEA type object
+    if (gps.decode(Serial1.read()) && gps.sentence_type() == GPGGA) {
+      const NMEAGGA& fix = gps.gga();
+      Serial.print("Quality = ");
+      Serial.print(fix.quality, DEC);
+      Serial.print(" satellites = ");
+      Serial.print(fix.satellites, DEC);
+      // altitude is in centimeters
+      Serial.print(" altitude = ");
+      Serial.print(fix.altitude / 100);
+      Serial.print(" m, 3D fix = ");
+      Serial.println(gps.gsa().fix == 3 ? "yes" : "no");
+      // latitude and longitude are in 1e-7 degrees
+      Serial.print("Position = ");
+      Serial.print(fix.latitude);
+      Serial.print(", ");
+      Serial.println(fix.longitude);
+    }
+  }
+}
@@ -15,49 +15,56 @@
 ||
 */
 
+#include <string.h>
 #include "nmea.h"
 
-#define _GPRMC_TERM   "$GPRMC,"   // GPRMC datatype identifier
-#define _LIB_VERSION  1           // software version of this library
+#define _LIB_VERSION  2           // software version of this library
 
 /*
 || @constructor
 || | Initializes the NMEA library
-|| | Allocates memory for individual terms of sentence
 || #
 ||
-|| @parameter connect Can be ALL or GPRMC
+|| @parameter connect Can be ALL, GPRMC, GPGGA, GPVTG or GPGSA
 */
 NMEA::NMEA(int connect)
 {
   // private properties
-  _gprmc_only = connect;
-  _gprmc_utc = 0.0;
-  _gprmc_status = 'V';
-  _gprmc_lat = 0.0;
-  _gprmc_long = 0.0;
-  _gprmc_speed = 0.0;
-  _gprmc_angle = 0.0;
-  _terms = 0;
+  _connect = connect;
+  _sentence = _sentences[0];
+  f_sentence = _sentences[1];
+  _term = _offsets[0];
+  f_term = _offsets[1];
+  _rmc = &_rmcs[0];
+  f_rmc = &_rmcs[1];
+  _gga = &_ggas[0];
+  f_gga = &_ggas[1];
+  _vtg = &_vtgs[0];
+  f_vtg = &_vtgs[1];
+  _gsa = &_gsas[0];
+  f_gsa = &_gsas[1];
+  memset(_rmcs, 0, sizeof(_rmcs));
+  memset(_ggas, 0, sizeof(_ggas));
+  memset(_vtgs, 0, sizeof(_vtgs));
+  memset(_gsas, 0, sizeof(_gsas));
+  f_rmc->status = 'V';
+  _position_valid = false;
   n = 0;
+  _terms = 0;
+  _type = 0;
   _state = 0;
   _parity = 0;
-  _nt = 0;
 
   f_sentence[0] = 0;
   f_terms = 0;
-  // allocate memory for individual terms of sentence
-  for (int t = 0; t < 30; t++)
-  {
-    _term[t] = (char*) malloc(15 * sizeof(char));
-    f_term[t] = (char*) malloc(15 * sizeof(char));
-    (f_term[t])[0] = 0;
-  }
+  f_type = 0;
+  _term_split = false;
 }
 
 /*
 || @description
-|| |
+|| | Terms are decoded as their characters arrive, the sentence is only
+|| | accepted once the checksum matches.
 || #
 ||
 || @parameter c Add char c to the raw sentence
@@ -65,136 +72,86 @@ NMEA::NMEA(int connect)
 */
 int NMEA::decode(char c)
 {
-  // avoid runaway sentences (>99 chars or >29 terms) and terms (>14 chars)
-  if ((n >= 100) || (_terms >= 30) || (_nt >= 15))
-  {
-    _state = 0;
-  }
   // LF and CR always reset parser
   if ((c == 0x0A) || (c == 0x0D))
   {
     _state = 0;
+    return 0;
   }
   // '$' always starts a new sentence
   if (c == '$')
   {
-    _gprmc_tag = 0;
     _parity = 0;
     _terms = 0;
-    _nt = 0;
+    _type = 0;
     _sentence[0] = c;
+    _term[0] = 1;
     n = 1;
     _state = 1;
+    _begin_term();
+    return 0;
+  }
+  // waiting for '$', do nothing
+  if (_state == 0)
+  {
     return 0;
   }
-  // parse other chars according to parser state
+  // avoid runaway sentences, leave room for the terminating zero
+  if (n >= NMEA_MAX_SENTENCE - 1)
+  {
+    _state = 0;
+    return 0;
+  }
+  // add received char to sentence
+  _sentence[n++] = c;
+  // parse chars according to parser state
   switch (_state)
   {
-  case 0:
-    // waiting for '$', do nothing
-    break;
   case 1:
     // decode chars after '$' and before '*' found
-    if (n < 7)
+    if ((c == ',') || (c == '*'))
     {
-      // see if first seven chars match "$GPRMC,"
-      if (c == _GPRMC_TERM[n])
+      // ',' delimits the individual terms, '*' precedes the checksum term
+      _end_term();
+      if (++_terms >= NMEA_MAX_TERMS)
+      {
+        _state = 0;
+        break;
+      }
+      _term[_terms] = n;
+      _begin_term();
+      if (c == ',')
+      {
+        _parity ^= c;
+      }
+      else
       {
-        _gprmc_tag++;
+        _state++;
       }
     }
-    // add received char to sentence
-    _sentence[n++] = c;
-    switch (c)
+    else
     {
-    case ',':
-      // ',' delimits the individual terms
-      (_term[_terms++])[_nt] = 0;
-      _nt = 0;
-      _parity = _parity ^ c;
-      break;
-    case '*':
-      // '*' delimits term and precedes checksum term
-      (_term[_terms++])[_nt] = 0;
-      _nt = 0;
-      _state++;
-      break;
-    default:
       // all other chars between '$' and '*' are part of a term
-      (_term[_terms])[_nt++] = c;
-      _parity = _parity ^ c;
-      break;
+      _add_char(c);
+      _parity ^= c;
     }
     break;
   case 2:
     // first char following '*' is checksum MSB
-    _sentence[n++] = c;
-    (_term[_terms])[_nt++] = c;
-    _parity = _parity - (16 * _dehex(c));   // replace with bitshift?
+    _checksum = _dehex(c) << 4;
     _state++;
     break;
   case 3:
     // second char after '*' completes the checksum (LSB)
-    _sentence[n++] = c;
-    _sentence[n++] = 0;
-    (_term[_terms])[_nt++] = c;
-    (_term[_terms++])[_nt] = 0;
+    _sentence[n] = 0;
     _state = 0;
-    _parity = _parity - _dehex(c);
-    // when parity is zero, checksum was correct!
-    if (_parity == 0)
+    _checksum |= _dehex(c);
+    // accept all sentences, or only one datatype?
+    if ((_checksum == _parity) && ((!_connect) || (_connect == _type)))
     {
-      // accept all sentences, or only GPRMC datatype?
-      if ((!_gprmc_only) || (_gprmc_tag == 6))
-      {
-        // copy _sentence[] to f_sentence[]
-        while ((--n) >= 0)
-        {
-          f_sentence[n] = _sentence[n];
-        }
-        // copy all _terms[] to f_terms[]
-        for (f_terms = 0; f_terms < _terms; f_terms++)
-        {
-          _nt = 0;
-          while ((_term[f_terms])[_nt])
-          {
-            (f_term[f_terms])[_nt] = (_term[f_terms])[_nt];
-            _nt++;
-          }
-          (f_term[f_terms])[_nt] = 0;
-        }
-        // when sentence is of datatype GPRMC
-        if (_gprmc_tag == 6)
-        {
-          // store values of relevant GPRMC terms
-          _gprmc_utc = _decimal(_term[1]);
-          _gprmc_status = (_term[2])[0];
-          // calculate signed degree-decimal value of latitude term
-          _gprmc_lat = _decimal(_term[3]) / 100.0;
-          _degs = floor(_gprmc_lat);
-          _gprmc_lat = (100.0 * (_gprmc_lat - _degs)) / 60.0;
-          _gprmc_lat += _degs;
-          // southern hemisphere is negative-valued
-          if ((_term[4])[0] == 'S')
-          {
-            _gprmc_lat = 0.0 - _gprmc_lat;
-          }
-          // calculate signed degree-decimal value of longitude term
-          _gprmc_long = _decimal(_term[5]) / 100.0;
-          _degs = floor(_gprmc_long);
-          _gprmc_long = (100.0 * (_gprmc_long - _degs)) / 60.0;
-          _gprmc_long += _degs;
-          // western hemisphere is negative-valued
-          if ((_term[6])[0] == 'W')
-          {
-            _gprmc_long = 0.0 - _gprmc_long;
-          }
-          _gprmc_speed = _decimal(_term[7]);
-          _gprmc_angle = _decimal(_term[8]);
-        }
-        // sentence accepted!
-        return 1;
-      }
+      _commit();
+      // sentence accepted!
+      return 1;
     }
     break;
   default:
@@ -213,7 +170,7 @@ int NMEA::decode(char c)
 */
 float NMEA::gprmc_utc()
 {
-  return _gprmc_utc;
+  return f_rmc->utc / 1000.0;
 }
 
 /*
@@ -225,7 +182,7 @@ float NMEA::gprmc_utc()
 */
 char NMEA::gprmc_status()
 {
-  return _gprmc_status;
+  return f_rmc->status;
 }
 
 /*
@@ -237,7 +194,7 @@ char NMEA::gprmc_status()
 */
 float NMEA::gprmc_latitude()
 {
-  return _gprmc_lat;
+  return f_rmc->latitude / 1e7;
 }
 
 /*
@@ -249,8 +206,7 @@ float NMEA::gprmc_latitude()
 */
 float NMEA::gprmc_longitude()
 {
-  // returns signed degree-decimal longitude value of last-known GPRMC position
-  return _gprmc_long;
+  return f_rmc->longitude / 1e7;
 }
 
 /*
@@ -262,7 +218,7 @@ float NMEA::gprmc_longitude()
 */
 float NMEA::gprmc_speed(float unit)
 {
-  return (_gprmc_speed * unit);
+  return (f_rmc->speed / 100.0) * unit;
 }
 
 /*
@@ -274,7 +230,7 @@ float NMEA::gprmc_speed(float unit)
 */
 float NMEA::gprmc_course()
 {
-  return _gprmc_angle;
+  return f_rmc->course / 100.0;
 }
 
 /*
@@ -286,7 +242,7 @@ float NMEA::gprmc_course()
 */
 float NMEA::gprmc_distance_to(float latitude, float longitude, float unit)
 {
-  return distance_between(_gprmc_lat, _gprmc_long, latitude, longitude, unit);
+  return gprmc_distance_to(Waypoint(latitude, longitude), unit);
 }
 
 /*
@@ -298,7 +254,114 @@ float NMEA::gprmc_distance_to(float latitude, float longitude, float unit)
 */
 float NMEA::gprmc_course_to(float latitude, float longitude)
 {
-  return initial_course(_gprmc_lat, _gprmc_long, latitude, longitude);
+  return gprmc_course_to(Waypoint(latitude, longitude));
+}
+
+/*
+|| @description
+|| | Get last-known GPRMC position as a waypoint, its trigonometry is
+|| | computed on the first call after each new GPRMC sentence
+|| #
+||
+|| @return The last-known GPRMC position
+*/
+const Waypoint& NMEA::gprmc_position()
+{
+  if (!_position_valid)
+  {
+    _position.set_fixed(f_rmc->latitude, f_rmc->longitude);
+    _position_valid = true;
+  }
+  return _position;
+}
+
+/*
+|| @description
+|| | Get distance from last-known GPRMC position to waypoint w
+|| #
+||
+|| @parameter w The waypoint
+|| @parameter unit Units per meter: MTR, KM, MI or NM
+|| @parameter method HAVERSINE or EQUIRECTANGULAR
+|| @return The distance from last-known GPRMC position to waypoint w
+*/
+float NMEA::gprmc_distance_to(const Waypoint& w, float unit, int method)
+{
+  return gprmc_position().distance_to(w, unit, method);
+}
+
+/*
+|| @description
+|| | Get initial course in degrees from last-known GPRMC position to waypoint w
+|| #
+||
+|| @parameter w The waypoint
+|| @parameter method HAVERSINE or EQUIRECTANGULAR
+|| @return The initial course in degrees from last-known GPRMC position to waypoint w
+*/
+float NMEA::gprmc_course_to(const Waypoint& w, int method)
+{
+  return gprmc_position().course_to(w, method);
+}
+
+/*
+|| @description
+|| | Get the fixed-point terms of the last full RMC sentence
+|| #
+||
+|| @return The terms of the last full RMC sentence
+*/
+const NMEARMC& NMEA::rmc()
+{
+  return *f_rmc;
+}
+
+/*
+|| @description
+|| | Get the fixed-point terms of the last full GGA sentence
+|| #
+||
+|| @return The terms of the last full GGA sentence
+*/
+const NMEAGGA& NMEA::gga()
+{
+  return *f_gga;
+}
+
+/*
+|| @description
+|| | Get the fixed-point terms of the last full VTG sentence
+|| #
+||
+|| @return The terms of the last full VTG sentence
+*/
+const NMEAVTG& NMEA::vtg()
+{
+  return *f_vtg;
+}
+
+/*
+|| @description
+|| | Get the fixed-point terms of the last full GSA sentence
+|| #
+||
+|| @return The terms of the last full GSA sentence
+*/
+const NMEAGSA& NMEA::gsa()
+{
+  return *f_gsa;
+}
+
+/*
+|| @description
+|| | Get the datatype of the last received full sentence, whatever its talker
+|| #
+||
+|| @return GPRMC, GPGGA, GPVTG, GPGSA or 0 for other datatypes
+*/
+int NMEA::sentence_type()
+{
+  return f_type;
 }
 
 /*
@@ -334,7 +397,24 @@ int NMEA::terms()
 */
 char* NMEA::term(int t)
 {
-  return f_term[t];
+  static char empty[1] = "";
+
+  // terms are not zero terminated in the sentence, so the first call
+  // after a sentence is accepted splits a copy of it, once for all terms
+  if (!_term_split)
+  {
+    int i = 0;
+    do
+    {
+      char c = f_sentence[i];
+      _term_text[i] = ((c == ',') || (c == '*')) ? 0 : c;
+    }
+    while (f_sentence[i++]);
+    _term_split = true;
+  }
+  if ((t >= 0) && (t < f_terms))
+    return _term_text + f_term[t];
+  return empty;
 }
 
 /*
@@ -346,7 +426,7 @@ char* NMEA::term(int t)
 */
 float NMEA::term_decimal(int t)
 {
-  return _decimal(f_term[t]);
+  return _decimal(term(t));
 }
 
 /*
@@ -363,53 +443,242 @@ int NMEA::libversion()
 
 /// private methods
 
-float NMEA::distance_between(float lat1, float long1, float lat2, float long2, float units_per_meter)
+void NMEA::_begin_term()
+{
+  _whole = 0;
+  _fraction = 0;
+  _fraction_digits = 0;
+  _first = 0;
+  _point = false;
+  _negative = false;
+}
+
+void NMEA::_add_char(char c)
+{
+  // keep a numeric value of every term, used or not; it is cheaper
+  // than deciding per character whether it is needed
+  if (!_first)
+  {
+    _first = c;
+  }
+  if ((c >= '0') && (c <= '9'))
+  {
+    if (!_point)
+    {
+      _whole = (10 * _whole) + (c - '0');
+    }
+    else if (_fraction_digits < 7)
+    {
+      _fraction = (10 * _fraction) + (c - '0');
+      _fraction_digits++;
+    }
+  }
+  else if (c == '.')
+  {
+    _point = true;
+  }
+  else if (c == '-')
+  {
+    _negative = true;
+  }
+}
+
+long NMEA::_fixed(byte decimals)
 {
-  // returns distance in meters between two positions, both specified
-  // as signed decimal-degrees latitude and longitude. Uses great-circle
-  // distance computation for hypothised sphere of radius 6372795 meters.
-  // Because Earth is no exact sphere, rounding errors may be upto 0.5%.
-  float delta = radians(long1 - long2);
-  float sdlong = sin(delta);
-  float cdlong = cos(delta);
-  lat1 = radians(lat1);
-  lat2 = radians(lat2);
-  float slat1 = sin(lat1);
-  float clat1 = cos(lat1);
-  float slat2 = sin(lat2);
-  float clat2 = cos(lat2);
-  delta = (clat1 * slat2) - (slat1 * clat2 * cdlong);
-  delta = sq(delta);
-  delta += sq(clat2 * sdlong);
-  delta = sqrt(delta);
-  float denom = (slat1 * slat2) + (clat1 * clat2 * cdlong);
-  delta = atan2(delta, denom);
-  return delta * 6372795 * units_per_meter;
+  // value of the current term with the given number of decimals
+  unsigned long whole = _whole;
+  unsigned long fraction = _fraction;
+  byte d;
+
+  for (d = 0; d < decimals; d++)
+  {
+    whole *= 10;
+  }
+  for (d = _fraction_digits; d < decimals; d++)
+  {
+    fraction *= 10;
+  }
+  for (d = decimals; d < _fraction_digits; d++)
+  {
+    fraction /= 10;
+  }
+  whole += fraction;
+  return _negative ? -(long)whole : (long)whole;
+}
+
+long NMEA::_degrees()
+{
+  // (d)ddmm.mmmm as degrees * 1e7; minutes * 1e5 * 10 / 6 gives
+  // the minutes in units of 1e-7 degrees
+  unsigned long degrees = _whole / 100;
+  unsigned long minutes = _whole % 100;
+  unsigned long fraction = _fraction;
+  byte d;
+
+  for (d = _fraction_digits; d < 5; d++)
+  {
+    fraction *= 10;
+  }
+  for (d = 5; d < _fraction_digits; d++)
+  {
+    fraction /= 10;
+  }
+  minutes = (minutes * 100000) + fraction;
+  return (degrees * 10000000) + ((minutes * 10 + 3) / 6);
+}
+
+void NMEA::_end_term()
+{
+  // datatype term: the last three chars name the sentence, the
+  // first two the talker
+  if (_terms == 0)
+  {
+    if (n < 7)
+    {
+      return;
+    }
+    char* s = _sentence + n - 4;
+    if (!strncmp(s, "RMC", 3))
+    {
+      _type = GPRMC;
+      memset(_rmc, 0, sizeof(NMEARMC));
+      _rmc->status = 'V';
+    }
+    else if (!strncmp(s, "GGA", 3))
+    {
+      _type = GPGGA;
+      memset(_gga, 0, sizeof(NMEAGGA));
+    }
+    else if (!strncmp(s, "VTG", 3))
+    {
+      _type = GPVTG;
+      memset(_vtg, 0, sizeof(NMEAVTG));
+    }
+    else if (!strncmp(s, "GSA", 3))
+    {
+      _type = GPGSA;
+      memset(_gsa, 0, sizeof(NMEAGSA));
+    }
+    return;
+  }
+  // empty terms leave the field at zero
+  if (!_first)
+  {
+    return;
+  }
+  switch (_type)
+  {
+  case GPRMC:
+    switch (_terms)
+    {
+    case 1: _rmc->utc = _fixed(3); break;
+    case 2: _rmc->status = _first; break;
+    case 3: _rmc->latitude = _degrees(); break;
+    case 4: if (_first == 'S') _rmc->latitude = -_rmc->latitude; break;
+    case 5: _rmc->longitude = _degrees(); break;
+    case 6: if (_first == 'W') _rmc->longitude = -_rmc->longitude; break;
+    case 7: _rmc->speed = _fixed(2); break;
+    case 8: _rmc->course = _fixed(2); break;
+    case 9: _rmc->date = _whole; break;
+    }
+    break;
+  case GPGGA:
+    switch (_terms)
+    {
+    case 1: _gga->utc = _fixed(3); break;
+    case 2: _gga->latitude = _degrees(); break;
+    case 3: if (_first == 'S') _gga->latitude = -_gga->latitude; break;
+    case 4: _gga->longitude = _degrees(); break;
+    case 5: if (_first == 'W') _gga->longitude = -_gga->longitude; break;
+    case 6: _gga->quality = _whole; break;
+    case 7: _gga->satellites = _whole; break;
+    case 8: _gga->hdop = _fixed(2); break;
+    case 9: _gga->altitude = _fixed(2); break;
+    }
+    break;
+  case GPVTG:
+    switch (_terms)
+    {
+    case 1: _vtg->course = _fixed(2); break;
+    case 5: _vtg->speed = _fixed(2); break;
+    case 7: _vtg->speed_kmh = _fixed(2); break;
+    }
+    break;
+  case GPGSA:
+    switch (_terms)
+    {
+    case 1: _gsa->mode = _first; break;
+    case 2: _gsa->fix = _whole; break;
+    case 15: _gsa->pdop = _fixed(2); break;
+    case 16: _gsa->hdop = _fixed(2); break;
+    case 17: _gsa->vdop = _fixed(2); break;
+    default:
+      // terms 3 to 14 list the satellites used
+      if (_terms <= 14)
+      {
+        _gsa->satellites++;
+      }
+      break;
+    }
+    break;
+  }
 }
 
-float NMEA::initial_course(float lat1, float long1, float lat2, float long2)
+void NMEA::_commit()
 {
-  // returns initial course in degrees (North=0, West=270) from
-  // position 1 to position 2, both specified as signed decimal-degrees
-  // latitude and longitude.
-  float dlon = radians(long2 - long1);
-  lat1 = radians(lat1);
-  lat2 = radians(lat2);
-  float a1 = sin(dlon) * cos(lat2);
-  float a2 = sin(lat1) * cos(lat2) * cos(dlon);
-  a2 = cos(lat1) * sin(lat2) - a2;
-  a2 = atan2(a1, a2);
-  if (a2 < 0.0)
+  // the received sentence becomes the accepted one and the old
+  // accepted buffers are reused for the next sentence
+  char* s = f_sentence;
+  f_sentence = _sentence;
+  _sentence = s;
+  byte* t = f_term;
+  f_term = _term;
+  _term = t;
+  f_terms = _terms + 1;
+  f_type = _type;
+  _term_split = false;
+  switch (_type)
   {
-    a2 += TWO_PI;     // modulo operator doesn't seem to work on floats
+  case GPRMC:
+  {
+    NMEARMC* p = f_rmc;
+    f_rmc = _rmc;
+    _rmc = p;
+    _position_valid = false;
+    break;
+  }
+  case GPGGA:
+  {
+    NMEAGGA* p = f_gga;
+    f_gga = _gga;
+    _gga = p;
+    break;
+  }
+  case GPVTG:
+  {
+    NMEAVTG* p = f_vtg;
+    f_vtg = _vtg;
+    _vtg = p;
+    break;
+  }
+  case GPGSA:
+  {
+    NMEAGSA* p = f_gsa;
+    f_gsa = _gsa;
+    _gsa = p;
+    break;
+  }
   }
-  return degrees(a2);
 }
 
 int NMEA::_dehex(char a)
 {
-  // returns base-16 value of chars '0'-'9' and 'A'-'F';
+  // returns base-16 value of chars '0'-'9', 'A'-'F' and 'a'-'f';
   // does not trap invalid chars!
+  if (int(a) >= 97)
+  {
+    return int(a) - 87;
+  }
   if (int(a) >= 65)
   {
     return int(a) - 55;
@@ -8,6 +8,13 @@
 || @description
 || | NMEA 0183 sentence decoding library.
 || |
+|| | Terms are converted to fixed-point integers while the characters
+|| | arrive, so nothing is parsed twice and no floating point is needed.
+|| | RMC, GGA, VTG and GSA sentences from any talker (GP, GN, GL, ...)
+|| | are decoded into the structures below.  A sentence is received into
+|| | a spare buffer and only becomes visible, by swapping pointers, once
+|| | its checksum is known to be good.
+|| |
 || | Wiring Cross-platform Library
 || #
 ||
@@ -19,9 +26,13 @@
 #define NMEA_h
 
 #include <Wiring.h>
+#include "waypoint.h"
 
 #define ALL         0               // connect to all datatypes
-#define GPRMC       1               // connect only to GPRMC datatype
+#define GPRMC       1               // connect only to RMC datatype
+#define GPGGA       2               // connect only to GGA datatype
+#define GPVTG       3               // connect only to VTG datatype
+#define GPGSA       4               // connect only to GSA datatype
 #define MTR         1.0             // meters per meter
 #define KM          0.001           // kilometers per meter
 #define MI          0.00062137112   // miles per meter
@@ -33,10 +44,60 @@
 #define KTS         1.0             // knots in one knot
 #define LIGHTSPEED  0.000000001716  // lightspeeds in one knot
 
+#ifndef NMEA_MAX_SENTENCE
+#define NMEA_MAX_SENTENCE 83        // 82 characters plus the terminating zero
+#endif
+#ifndef NMEA_MAX_TERMS
+#define NMEA_MAX_TERMS    30        // including datatype and checksum
+#endif
+
+// Recommended minimum data
+struct NMEARMC
+{
+  long utc;             // hhmmss.sss as hhmmsssss
+  long date;            // ddmmyy
+  long latitude;        // degrees * 1e7, south is negative
+  long longitude;       // degrees * 1e7, west is negative
+  long speed;           // knots * 100
+  long course;          // degrees * 100
+  char status;          // 'A' active, 'V' void
+};
+
+// Fix information
+struct NMEAGGA
+{
+  long utc;             // hhmmss.sss as hhmmsssss
+  long latitude;        // degrees * 1e7, south is negative
+  long longitude;       // degrees * 1e7, west is negative
+  long altitude;        // meters above mean sea level * 100
+  unsigned int hdop;    // horizontal dilution of precision * 100
+  byte quality;         // 0 invalid, 1 GPS, 2 DGPS, ...
+  byte satellites;      // satellites in use
+};
+
+// Course and speed over ground
+struct NMEAVTG
+{
+  long course;          // true course in degrees * 100
+  long speed;           // knots * 100
+  long speed_kmh;       // kilometers-per-hour * 100
+};
+
+// Dilution of precision and active satellites
+struct NMEAGSA
+{
+  unsigned int pdop;    // position dilution of precision * 100
+  unsigned int hdop;    // horizontal dilution of precision * 100
+  unsigned int vdop;    // vertical dilution of precision * 100
+  char mode;            // 'M' manual, 'A' automatic 2D/3D
+  byte fix;             // 1 no fix, 2 2D, 3 3D
+  byte satellites;      // satellites used for the fix
+};
+
 class NMEA
 {
   public:
-    NMEA(int connect);          // constructor for NMEA parser object; parse sentences of GPRMC or all datatypes.
+    NMEA(int connect);          // constructor for NMEA parser object; parse sentences of one or all datatypes.
 
     int   decode(char c);       // parse one character received from GPS; returns 1 when full sentence found w/ checksum OK, 0 otherwise
     float gprmc_utc();          // returns decimal value of UTC term in last full GPRMC sentence
@@ -47,41 +108,76 @@ class NMEA
     float gprmc_course();       // track-angle-made-good term in last full GPRMC sentence
     float gprmc_distance_to(float latitude, float longitude, float unit); // returns distance from last-known GPRMC position to given position
     float gprmc_course_to(float latitude, float longitude);     // returns initial course in degrees from last-known GPRMC position to given position
+    const Waypoint& gprmc_position();   // last-known GPRMC position, trigonometry computed once per sentence
+    float gprmc_distance_to(const Waypoint& w, float unit, int method = HAVERSINE); // returns distance from last-known GPRMC position to waypoint w
+    float gprmc_course_to(const Waypoint& w, int method = HAVERSINE);  // returns initial course in degrees from last-known GPRMC position to waypoint w
+    const NMEARMC& rmc();       // fixed-point terms of last full RMC sentence
+    const NMEAGGA& gga();       // fixed-point terms of last full GGA sentence
+    const NMEAVTG& vtg();       // fixed-point terms of last full VTG sentence
+    const NMEAGSA& gsa();       // fixed-point terms of last full GSA sentence
+    int   sentence_type();      // returns GPRMC, GPGGA, GPVTG or GPGSA for the last received full sentence, 0 for other datatypes
     char* sentence();           // returns last received full sentence as zero terminated string
     int   terms();              // returns number of terms (including data type and checksum) in last received full sentence
-    char* term(int t);          // returns term t of last received full sentence as zero terminated string
+    char* term(int t);          // returns term t of last received full sentence as zero terminated string, valid until the next sentence
     float term_decimal(int t);  // returns the base-10 converted value of term[t] in last full sentence received
     int   libversion();         // returns software version number of NMEA library
 
   private:
     // methods
-    float distance_between(float lat1, float long1, float lat2, float long2, float units_per_meter);
-    float initial_course(float lat1, float long1, float lat2, float long2);
     int   _dehex(char a);
     float _decimal(char* s);
+    void  _begin_term();
+    void  _add_char(char c);
+    void  _end_term();
+    long  _fixed(byte decimals);
+    long  _degrees();
+    void  _commit();
 
     // properties
-    int   _gprmc_only;
-    float _gprmc_utc;
-    char  _gprmc_status;
-    float _gprmc_lat;
-    float _gprmc_long;
-    float _gprmc_speed;
-    float _gprmc_angle;
-    char  f_sentence[100];
-    char* f_term[30];
+    int   _connect;
+    // sentence being received and last accepted one, swapped on commit
+    char  _sentences[2][NMEA_MAX_SENTENCE];
+    byte  _offsets[2][NMEA_MAX_TERMS];   // start of each term in the sentence
+    char* _sentence;
+    char* f_sentence;
+    byte* _term;
+    byte* f_term;
     int   f_terms;
-    int   _terms;
-    char  _sentence[100];
-    char* _term[30];
-    int   n;
-    int   _gprmc_tag;
-    int   _state;
-    int   _parity;
-    int   _nt;
-    float _degs;
+    int   f_type;
+    // copy of the accepted sentence with its terms zero terminated, made
+    // by the first term() call after a sentence is accepted
+    char  _term_text[NMEA_MAX_SENTENCE];
+    boolean _term_split;
+    // typed terms, again one being filled in and one accepted
+    NMEARMC _rmcs[2];
+    NMEAGGA _ggas[2];
+    NMEAVTG _vtgs[2];
+    NMEAGSA _gsas[2];
+    NMEARMC* _rmc;
+    NMEARMC* f_rmc;
+    NMEAGGA* _gga;
+    NMEAGGA* f_gga;
+    NMEAVTG* _vtg;
+    NMEAVTG* f_vtg;
+    NMEAGSA* _gsa;
+    NMEAGSA* f_gsa;
+    Waypoint _position;
+    boolean _position_valid;
+    // parser state
+    byte  n;
+    byte  _terms;
+    byte  _type;
+    byte  _state;
+    byte  _parity;
+    byte  _checksum;
+    // value of the term being received
+    unsigned long _whole;
+    unsigned long _fraction;
+    byte  _fraction_digits;
+    char  _first;
+    boolean _point;
+    boolean _negative;
 };
 
 #endif
 // NMEA_H
-
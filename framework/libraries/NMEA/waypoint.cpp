@@ -0,0 +1,284 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Distance and course between positions with cached trigonometry.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include "waypoint.h"
+
+#define _EARTH_RADIUS   6372795.0               // meters
+#define _RADIANS        (1e-7 * DEG_TO_RAD)     // radians in one unit of delta()
+#define _HALF_CIRCLE    1800000000L             // 180 degrees in units of delta()
+#define _METERS         11663                   // meters in one unit of delta(), * 2^20
+
+// square root of n, rounded to the nearest integer
+static unsigned long isqrt(unsigned long n)
+{
+  unsigned long root = 0;
+  unsigned long bit = 1UL << 30;
+
+  while (bit > n)
+  {
+    bit >>= 2;
+  }
+  while (bit)
+  {
+    if (n >= root + bit)
+    {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  // n now holds the remainder
+  if (n > root)
+  {
+    root++;
+  }
+  return root;
+}
+
+// arc tangent of n / d in degrees * 100 for 0 <= n <= d < 2^16, using
+// atan(r) = 45r + r(1 - r)(14.02 + 3.80r) degrees, good to 0.09 degrees
+static long atan_fixed(unsigned long n, unsigned long d)
+{
+  unsigned long r = (n << 15) / d;              // ratio * 32768
+  unsigned long t = (r * (32768 - r)) >> 15;    // r(1 - r) * 32768
+
+  return (4500 * r + t * (1402 + ((380 * r) >> 15)) + 16384) >> 15;
+}
+
+Waypoint::Waypoint()
+{
+  set_fixed(0, 0);
+}
+
+Waypoint::Waypoint(float latitude, float longitude)
+{
+  set(latitude, longitude);
+}
+
+/*
+|| @description
+|| | Move the waypoint, computes the sine and cosine of the latitude
+|| #
+||
+|| @parameter latitude Signed degree-decimal latitude, south is negative
+|| @parameter longitude Signed degree-decimal longitude, west is negative
+*/
+void Waypoint::set(float latitude, float longitude)
+{
+  set_fixed(lround(latitude * 1e7), lround(longitude * 1e7));
+}
+
+/*
+|| @description
+|| | Move the waypoint, computes the sine and cosine of the latitude
+|| #
+||
+|| @parameter latitude Latitude in degrees * 1e7, south is negative
+|| @parameter longitude Longitude in degrees * 1e7, west is negative
+*/
+void Waypoint::set_fixed(long latitude, long longitude)
+{
+  float lat = latitude * (1e-7 * DEG_TO_RAD);
+
+  _latitude = latitude;
+  _longitude = longitude;
+  _sin_lat = sin(lat);
+  _cos_lat = cos(lat);
+  _cos_lat_fixed = _cos_lat * 32768.0 + 0.5;
+}
+
+float Waypoint::latitude() const
+{
+  return _latitude / 1e7;
+}
+
+float Waypoint::longitude() const
+{
+  return _longitude / 1e7;
+}
+
+/*
+|| @description
+|| | Get the distance to another waypoint
+|| #
+||
+|| @parameter to The other waypoint
+|| @parameter unit Units per meter: MTR, KM, MI or NM
+|| @parameter method HAVERSINE or EQUIRECTANGULAR
+|| @return The distance in the given unit
+*/
+float Waypoint::distance_to(const Waypoint& to, float unit, int method) const
+{
+  long dlat;
+  long dlon;
+  float d;
+
+  delta(to, dlat, dlon);
+  float y = dlat * _RADIANS;
+  float x = dlon * _RADIANS;
+  if (method == HAVERSINE)
+  {
+    float a = sq(sin(y / 2)) + _cos_lat * to._cos_lat * sq(sin(x / 2));
+    // rounding may push antipodal points over the edge
+    if (a > 1.0)
+    {
+      a = 1.0;
+    }
+    d = 2 * asin(sqrt(a));
+  }
+  else
+  {
+    x *= (_cos_lat + to._cos_lat) / 2;
+    d = sqrt(sq(x) + sq(y));
+  }
+  return d * _EARTH_RADIUS * unit;
+}
+
+/*
+|| @description
+|| | Get the initial course to another waypoint
+|| #
+||
+|| @parameter to The other waypoint
+|| @parameter method HAVERSINE or EQUIRECTANGULAR
+|| @return The course in degrees (North=0, West=270)
+*/
+float Waypoint::course_to(const Waypoint& to, int method) const
+{
+  long dlat;
+  long dlon;
+  float a;
+
+  delta(to, dlat, dlon);
+  float x = dlon * _RADIANS;
+  if (method == HAVERSINE)
+  {
+    a = atan2(sin(x) * to._cos_lat, _cos_lat * to._sin_lat - _sin_lat * to._cos_lat * cos(x));
+  }
+  else
+  {
+    a = atan2(x * (_cos_lat + to._cos_lat) / 2, dlat * _RADIANS);
+  }
+  if (a < 0.0)
+  {
+    a += TWO_PI;
+  }
+  return degrees(a);
+}
+
+/*
+|| @description
+|| | Get the EQUIRECTANGULAR distance to another waypoint in integer math
+|| #
+||
+|| @parameter to The other waypoint
+|| @return The distance in meters
+*/
+long Waypoint::distance_to_fixed(const Waypoint& to) const
+{
+  long dlat;
+  long dlon;
+  byte shift = 0;
+
+  delta(to, dlat, dlon);
+  unsigned long y = labs(dlat);
+  unsigned long x = labs(dlon);
+  // scale both down so the sum of the squares can not overflow
+  while ((x >= 46341) || (y >= 46341))
+  {
+    x >>= 1;
+    y >>= 1;
+    shift++;
+  }
+  x = (x * ((_cos_lat_fixed + to._cos_lat_fixed) >> 1) + 16384) >> 15;
+  // 1.8e9 >> 16 is below 46341, so shift never exceeds 16
+  unsigned long d = isqrt(x * x + y * y) * _METERS;
+  shift = 20 - shift;
+  return (d + (1UL << (shift - 1))) >> shift;
+}
+
+/*
+|| @description
+|| | Get the EQUIRECTANGULAR course to another waypoint in integer math
+|| #
+||
+|| @parameter to The other waypoint
+|| @return The course in degrees * 100 (North=0, West=27000)
+*/
+long Waypoint::course_to_fixed(const Waypoint& to) const
+{
+  long dlat;
+  long dlon;
+  long a;
+
+  delta(to, dlat, dlon);
+  unsigned long y = labs(dlat);
+  unsigned long x = labs(dlon);
+  while ((x | y) >= 32768)
+  {
+    x >>= 1;
+    y >>= 1;
+  }
+  x = (x * ((_cos_lat_fixed + to._cos_lat_fixed) >> 1)) >> 15;
+  if (x == 0 && y == 0)
+  {
+    return 0;
+  }
+  // angle from the nearest axis, then fold into the right quadrant
+  if (x <= y)
+  {
+    a = atan_fixed(x, y);
+  }
+  else
+  {
+    a = 9000 - atan_fixed(y, x);
+  }
+  if (dlat < 0)
+  {
+    a = 18000 - a;
+  }
+  if (dlon < 0)
+  {
+    a = (36000 - a) % 36000;
+  }
+  return a;
+}
+
+/// private methods
+
+void Waypoint::delta(const Waypoint& to, long& dlat, long& dlon) const
+{
+  // latitudes are within 90 degrees, their difference always fits
+  dlat = to._latitude - _latitude;
+  // longitudes may differ by up to 360 degrees, so first see which way
+  // is shorter with half the values, then subtract without overflow
+  dlon = (to._longitude / 2) - (_longitude / 2);
+  if (dlon > _HALF_CIRCLE / 2)
+  {
+    dlon = (to._longitude - _HALF_CIRCLE) - (_longitude + _HALF_CIRCLE);
+  }
+  else if (dlon < -_HALF_CIRCLE / 2)
+  {
+    dlon = (to._longitude + _HALF_CIRCLE) - (_longitude - _HALF_CIRCLE);
+  }
+  else
+  {
+    dlon = to._longitude - _longitude;
+  }
+}
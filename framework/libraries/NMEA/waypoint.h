@@ -0,0 +1,82 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Distance and course between positions with cached trigonometry.
+|| |
+|| | A Waypoint keeps the sine and cosine of its latitude, so they are
+|| | computed once when the position is set instead of on every
+|| | distance or course calculation.  Two methods are offered:
+|| |
+|| | HAVERSINE       great-circle distance and initial course on a sphere
+|| |                 of radius 6372795 meters.  Because Earth is no exact
+|| |                 sphere, results may be off by up to 0.5%.  Costs two
+|| |                 sines, a square root and an arc sine for the distance,
+|| |                 a sine, a cosine and an arc tangent for the course.
+|| |
+|| | EQUIRECTANGULAR flat projection around the two positions, no sines or
+|| |                 cosines at all.  Compared to HAVERSINE, below 70
+|| |                 degrees latitude the distance is within 0.01% up to
+|| |                 100 km and within 1% up to 1000 km.  The course is
+|| |                 within 0.12 degrees per 10 km of distance (0.08 below
+|| |                 60 degrees latitude).
+|| |
+|| | distance_to_fixed() and course_to_fixed() compute EQUIRECTANGULAR
+|| | with integer math only, in meters and degrees * 100.  They add at
+|| | most 0.03% or 1 meter to the distance and 0.1 degrees to the course.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @example
+|| | Waypoint home(48.858342, 2.294522);
+|| | Waypoint here;
+|| |
+|| | here.set_fixed(gps.rmc().latitude, gps.rmc().longitude);
+|| | float d = here.distance_to(home, KM, EQUIRECTANGULAR);
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef WAYPOINT_H
+#define WAYPOINT_H
+
+#include <Wiring.h>
+
+#define EQUIRECTANGULAR  0          // fast flat approximation
+#define HAVERSINE        1          // great circle
+
+class Waypoint
+{
+  public:
+    Waypoint();
+    Waypoint(float latitude, float longitude);    // signed degree-decimal
+
+    void  set(float latitude, float longitude);   // signed degree-decimal
+    void  set_fixed(long latitude, long longitude);   // degrees * 1e7, as in NMEARMC
+    float latitude() const;
+    float longitude() const;
+
+    // distance in units per meter (MTR, KM, MI, NM) and initial course in degrees
+    float distance_to(const Waypoint& to, float unit, int method = HAVERSINE) const;
+    float course_to(const Waypoint& to, int method = HAVERSINE) const;
+    // EQUIRECTANGULAR in integer math: meters and degrees * 100
+    long  distance_to_fixed(const Waypoint& to) const;
+    long  course_to_fixed(const Waypoint& to) const;
+
+  private:
+    void  delta(const Waypoint& to, long& dlat, long& dlon) const;
+
+    long  _latitude;            // degrees * 1e7
+    long  _longitude;           // degrees * 1e7
+    float _sin_lat;
+    float _cos_lat;
+    unsigned int _cos_lat_fixed;    // cosine * 32768
+};
+
+#endif
+// WAYPOINT_H
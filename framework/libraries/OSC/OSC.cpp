@@ -32,6 +32,10 @@ const char WOSC::prefixA2d[6] ="/adc/";
 const char WOSC::prefixReset[7] ="/reset"; //TODO: implement
 //const byte WOSC::pwmPinMap[6] = {37, 36, 35, 31, 30, 29};
 
+WOSC *WOSC::receiver = NULL;
+// the root container catches every message for receiveMessage()
+const OSCMethod WOSC::builtinMethods[1] = { { "/", WOSC::receiveBuiltin } };
+
 /*
 || @constructor
 || | Initialize the OCS object
@@ -39,9 +43,8 @@ const char WOSC::prefixReset[7] ="/reset"; //TODO: implement
 || 
 || @parameter s The Stream to read and write WOSC messages from and to
 */
-WOSC::WOSC(Stream &s) : stream(&s) 
+WOSC::WOSC(Stream &s) : stream(&s), userMethods(NULL, 0), slip(s)
 {
-  oscRxNextOp = OSC_RXOP_WAITFORSTART;
   k = FIRST_ANALOG_PIN;
   int i;
   
@@ -74,7 +77,7 @@ void WOSC::begin()
 /*
 || @description
 || | Handle I/O 
-|| | Parse the received chars at the stream 
+|| | Dispatch the packets received on the stream
 || #
 */
 void WOSC::transmit() 
@@ -92,11 +95,14 @@ void WOSC::transmit()
   }
   k=(k+1)%NUM_ANALOG_PINS;
   
-  // handle all received serial bytes
-  while (stream->available() > 0) 
+  // handle every complete packet that has been received
+  // -> hand its messages to the sketch, then to our own methods
+  size_t length;
+  while ((length = slip.receive()) > 0) 
   {
-    int incomingByte = stream->read() & 0xFF;// read byte - truncate to 8bits to be safe
-    parse(incomingByte); // hand to message parser
+    userMethods.dispatch(slip.packet(), length);
+    receiver = this;
+    OSCDispatcher(builtinMethods, 1).dispatch(slip.packet(), length);
   }
 }
 
@@ -108,81 +114,75 @@ void WOSC::transmit()
 || | @parameter value    the payload to deliver to the address
 || #
 */
-void WOSC::sendMessage(char *address, unsigned long value)
+void WOSC::sendMessage(const char *address, unsigned long value)
 {
-  sendMessageInt(address,value);
+  oscPacket.reset();
+  oscPacket.message(address, (long)value);
+  send(oscPacket);
 }
 
-/// private methods
-
-void WOSC::sendMessageInt(char * address, unsigned long value)
+void WOSC::sendMessage(const char *address, float value)
 {
-  byte offset=0;
-  byte i=0;
+  oscPacket.reset();
+  oscPacket.message(address, value);
+  send(oscPacket);
+}
 
-  // clear buffer
-  for(i=0; i<MAX_LENGTH; i++) 
+/*
+|| @description
+|| | Send a packet built with an OSCEncoder, packets that overflowed
+|| | their buffer are dropped
+|| #
+*/
+void WOSC::send(const OSCEncoder &packet)
+{
+  if (!packet.overflow())
   {
-    oscBuffer[i]=0x00;
+    send(packet.data(), packet.length());
   }
+}
 
-  //write packet header
-  oscBuffer[offset++]=0xBE;
-
-  //compute message length 
-  //first compute address string length and padd if necessary
-  byte addrlen = strlen(address);
-  if(addrlen&0x03)				
-    addrlen += 4-(addrlen&0x03);
-
-  //then add type-tag length and arg length (both 4 for a simple int message)
-  byte typetaglen=4;
-  byte arglen = 4;
-
-  //final length is sum of the three
-  byte len = addrlen+typetaglen+arglen;
-
-  //write message length
-  oscBuffer[offset++]=(unsigned char)len;
-
-  //write address
-  strcpy(oscBuffer+offset,address); 
-  offset+=addrlen;
-
-  //write typetag
-  oscBuffer[offset++]=',';
-  oscBuffer[offset++]='i';
-  oscBuffer[offset++]=0x00;
-  oscBuffer[offset++]=0x00;
+/*
+|| @description
+|| | Frame and send an encoded OSC packet
+|| |
+|| | @parameter packet  the encoded message or bundle
+|| | @parameter length  its size in bytes
+|| #
+*/
+void WOSC::send(const uint8_t *packet, size_t length)
+{
+  slip.send(packet, length);
+}
 
-  //write argument
-  oscBuffer[offset++]=*(((unsigned char *)(&value))+3);
-  oscBuffer[offset++]=*(((unsigned char *)(&value))+2);
-  oscBuffer[offset++]=*(((unsigned char *)(&value))+1);
-  oscBuffer[offset++]=*(((unsigned char *)(&value))+0);
+/*
+|| @description
+|| | Use a table of methods for incoming messages
+|| |
+|| | @parameter methods  the addresses and their callbacks
+|| | @parameter count    number of entries in methods
+|| #
+*/
+void WOSC::attach(const OSCMethod *methods, uint8_t count)
+{
+  userMethods = OSCDispatcher(methods, count);
+}
 
-  //compute + write checksum
-  byte checksum=0;
-  for(i=2; i<offset; i++) 
-  {
-    checksum+=oscBuffer[i];
-  }
-  oscBuffer[offset++]=checksum;
+/// private methods
 
-  //send message byte-by-byte
-  for(i=0;i<offset;i++) 
-  {
-    stream->print(oscBuffer[i],BYTE);
-  }
+void WOSC::receiveBuiltin(OSCMessage &message)
+{
+  receiver->receiveMessage(message);
 }
 
-void WOSC::receiveMessageInt(char * msg, unsigned long value)
+void WOSC::receiveMessage(OSCMessage &message)
 {
-  int i;
+  const char *msg = message.address();
+  long value = message.getInt(0); // i, f, T and F are all fine
   int outPin;
   
   //uncomment to echo message back for debugging
-  //sendMessageInt(msg,value);
+  //sendMessage(msg,value);
   
   // check if this is an output message, i.e., starts with "/out/"
   if(strncmp(msg,prefixOut,strlen(prefixOut))==0) 
@@ -294,7 +294,6 @@ void WOSC::receiveMessageInt(char * msg, unsigned long value)
   //is this a reset message? if so, reinitialize.
   if(strncmp(msg,prefixReset,strlen(prefixReset))==0) 
   {
-    oscRxNextOp = OSC_RXOP_WAITFORSTART;
     setup();
   }
 }
@@ -320,7 +319,7 @@ void WOSC::checkDiscreteInputs()
         strcpy(oscOutAddress,prefixIn);
         char buf[4];
         strcat(oscOutAddress,itoa(i,buf,10));
-        sendMessage(oscOutAddress, !(state[i/8] & (1<<(i%8))));
+        sendMessage(oscOutAddress, (unsigned long)!(state[i/8] & (1<<(i%8))));
       }
     }
   }
@@ -349,180 +348,6 @@ void WOSC::checkAnalogInput(byte channel)
     strcpy(oscOutAddress,prefixA2d);
     char buf[4];
     strcat(oscOutAddress,itoa(channel,buf,10));
-    sendMessage(oscOutAddress, result);
+    sendMessage(oscOutAddress, (unsigned long)result);
   }
 }
-
-void WOSC::parse(unsigned char c) {
-  byte i;
-  switch(oscRxNextOp) 
-  {
-  case OSC_RXOP_WAITFORSTART:
-    if(c==0xBE) //0xBE is the magic start byte
-    {
-      oscRxNextOp = OSC_RXOP_READSIZE;
-    }
-    break;
-
-  case OSC_RXOP_READSIZE:
-    oscRxMsgSize = c; // read message size
-    oscRxReadBytes = 0; //reset index into message buffer
-    if(oscRxMsgSize < (OSC_MAX_RX_MSG_SIZE-1)) 
-    {
-      oscRxNextOp = OSC_RXOP_READADDR;
-    } 
-    else 
-    {
-      oscRxNextOp = OSC_RXOP_SKIPMSG; //Msg is too long
-    }
-    break;
-
-  case OSC_RXOP_READADDR:
-    if(c!=0 && c!=',') 
-    {
-      oscRxData[oscRxReadBytes++] = c; //copy normal addr byte
-    } 
-    else if (c==',') 
-    {
-      //if we went straight from addr to to tag string, convert "," of tag string to 0x00
-      // so our address string is properly zero-terminated
-      //and jump ahead in the state machine to read second tag byte next
-      oscRxData[oscRxReadBytes++]=0x00;
-      oscRxNextOp = OSC_RXOP_READTAGBYTE2;
-    }
-    else 
-    {
-      oscRxData[oscRxReadBytes++] = 0;
-      if(!((oscRxReadBytes)&0x03)) //skip 0s until we hit byte boundary
-      { 
-        oscRxNextOp = OSC_RXOP_READTAGBYTE1; 
-      } 
-    }
-    break;
-
-    // read type tag string bytes 1-4
-  case OSC_RXOP_READTAGBYTE1:
-    oscRxData[oscRxReadBytes++] = c;
-    if(c==',') 
-    {
-      // valid type tag start character found	
-      oscRxNextOp = OSC_RXOP_READTAGBYTE2;
-    } 
-    else 
-    {
-      // no type tag start char present
-      // assume one int arg and read its first byte
-      oscRxIntArg1 = 0;
-      oscRxIntArg1 |= ((unsigned long)(c) << 0x18);
-      oscRxNextOp = OSC_RXOP_READARG1BYTE2;
-    }
-    break;
-  case OSC_RXOP_READTAGBYTE2:
-    oscRxData[oscRxReadBytes++] = c;
-    switch (c) 
-    {
-    case 'i': //int32 argument
-      oscRxNextOp = OSC_RXOP_READTAGBYTE3;
-      break;
-      // all other types besides int are not supported yet
-      // so skip remainder of message
-    case 'f': //float arg
-    case 's': //string arg
-    default:
-      oscRxNextOp = OSC_RXOP_SKIPMSG;
-    }
-    break;
-  case OSC_RXOP_READTAGBYTE3:
-    oscRxData[oscRxReadBytes++] = c;
-    switch (c) 
-    {
-      // null - message has only one arg - we're ok
-    case 0:
-      oscRxNextOp = OSC_RXOP_READTAGBYTE4;
-      break;
-      // all others: not yet supported; skip rest of message
-    default:
-      oscRxNextOp = OSC_RXOP_SKIPMSG;
-      break;
-    }
-    break;
-  case OSC_RXOP_READTAGBYTE4:
-    oscRxData[oscRxReadBytes++] = c;
-    switch (c) 
-    {
-      // null - message has only one arg - we're ok
-    case 0:
-      oscRxNextOp = OSC_RXOP_READARG1BYTE1;
-      break;
-      // all others: not yet supported; skip rest of message
-    default:
-      oscRxNextOp = OSC_RXOP_SKIPMSG;
-      break;
-    }
-    break;
-
-    // read argument bytes 1-4
-  case OSC_RXOP_READARG1BYTE1:
-    oscRxData[oscRxReadBytes++] = c;
-    oscRxIntArg1 = 0;
-    oscRxIntArg1 |= ((unsigned long)(c) << 0x18);
-    oscRxNextOp = OSC_RXOP_READARG1BYTE2;
-    break;
-  case OSC_RXOP_READARG1BYTE2:
-    oscRxData[oscRxReadBytes++] = c;
-    oscRxIntArg1 |= ((unsigned long)(c) << 0x10);
-    oscRxNextOp = OSC_RXOP_READARG1BYTE3;
-    break;
-  case OSC_RXOP_READARG1BYTE3:
-    oscRxData[oscRxReadBytes++] = c;
-    oscRxIntArg1 |= ((unsigned long)(c) << 0x08);
-    oscRxNextOp = OSC_RXOP_READARG1BYTE4;
-    break;
-  case OSC_RXOP_READARG1BYTE4:
-    oscRxData[oscRxReadBytes++] = c;
-    oscRxIntArg1 |= (unsigned long)(c);
-    oscRxNextOp = OSC_RXOP_READCHECKSUM;
-    break;
-
-    // read checksum byte; check msg integrity; fire off user function
-  case OSC_RXOP_READCHECKSUM:
-    // check that we read the right number of bytes
-    if (oscRxReadBytes != oscRxMsgSize) 
-    {
-      sendMessageInt("/error/msgsize/",oscRxReadBytes);
-    } 
-    else {
-      oscRxChecksum = 0;
-      for (i=0; i<oscRxMsgSize; i++)
-      {
-        oscRxChecksum+=oscRxData[i];
-      }
-      if(oscRxChecksum == c) 
-      {
-        // checksum matched and we're done with this msg
-        // -> fire off user function
-        receiveMessageInt(oscRxData,oscRxIntArg1);
-
-      } 
-      else 
-      {
-        // mismatch - throw this message away
-        sendMessageInt("/error/checksum",oscRxChecksum);
-      }
-    }
-    // wait for next message header
-    oscRxNextOp = OSC_RXOP_WAITFORSTART;
-    break;
-
-    //skip rest of message - called if an error was detected in the current 
-    //incoming message
-  case OSC_RXOP_SKIPMSG:
-    if(++oscRxReadBytes == (oscRxMsgSize+1)) 
-    {
-      oscRxNextOp = OSC_RXOP_WAITFORSTART;
-    }
-    break;
-  default:
-    oscRxNextOp = OSC_RXOP_WAITFORSTART;
-  }
-}
\ No newline at end of file
@@ -9,6 +9,10 @@
 || | OSC Library.
 || | http://wiring.org.co/learning/topics/wiringosc.html
 || |
+|| | Received packets (messages or bundles) are decoded in place with
+|| | OSCMessage and handed to the methods of the sketch and to the
+|| | built in pin handling.  Outgoing packets are built with OSCEncoder.
+|| |
 || | Wiring Cross-platform Library
 || #
 ||
@@ -23,9 +27,15 @@
 #define OSC_h
 
 #include <Wiring.h>
+#include <SLIP.h>
+
+#include "OSCMessage.h"
+#include "OSCEncoder.h"
 
 #define MIN_A2D_DIFF 4  // threshold for reporting a2d changes
-#define MAX_LENGTH 24   // size of buffer for building WOSC msgs
+#ifndef OSC_MAX_TX_MSG_SIZE
+#define OSC_MAX_TX_MSG_SIZE 64 // size of buffer for building WOSC packets
+#endif
 #define OSC_SERIAL_SPEED 38400
 
 #define FIRST_DIGITAL_PIN 0 
@@ -39,24 +49,10 @@
 #define RX_PIN RX0
 #define TX_PIN TX0
 
-// define state constants for parsing FSM
-#define OSC_RXOP_WAITFORSTART 0
-#define OSC_RXOP_READSIZE 1
-#define OSC_RXOP_READADDR 2
-#define OSC_RXOP_READTAG 3
-#define OSC_RXOP_READARG 4
-#define OSC_RXOP_READCHECKSUM 5
-//removed READMSG
-#define OSC_RXOP_SKIPMSG 7
-#define OSC_RXOP_READARG1BYTE1 8
-#define OSC_RXOP_READARG1BYTE2 9
-#define OSC_RXOP_READARG1BYTE3 10
-#define OSC_RXOP_READARG1BYTE4 11
-#define OSC_RXOP_READTAGBYTE1 12
-#define OSC_RXOP_READTAGBYTE2 13
-#define OSC_RXOP_READTAGBYTE3 14
-#define OSC_RXOP_READTAGBYTE4 15
-#define OSC_MAX_RX_MSG_SIZE 32
+// packets are SLIP framed (as in OSC 1.1) and decoded in place
+#ifndef OSC_MAX_RX_MSG_SIZE
+#define OSC_MAX_RX_MSG_SIZE 128
+#endif
 
 
 class WOSC 
@@ -66,15 +62,21 @@ public:
   
   void begin();
   void transmit();
-  void sendMessage(char *address, unsigned long value);
+  void sendMessage(const char *address, unsigned long value);
+  void sendMessage(const char *address, float value);
+  // send a whole packet (message or bundle) built with an OSCEncoder
+  void send(const OSCEncoder &packet);
+  void send(const uint8_t *packet, size_t length);
+  // methods of the sketch, tried on every received message before the
+  // built in /out/, /pwm/, /report/, /pinmode/ and /reset handling
+  void attach(const OSCMethod *methods, uint8_t count);
     
   
 private:
   void checkDiscreteInputs();
   void checkAnalogInput(byte k);
-  void sendMessageInt(char * address, unsigned long value);
-  void receiveMessageInt(char * msg, unsigned long value);
-  void parse(unsigned char c);
+  void receiveMessage(OSCMessage &message);
+  static void receiveBuiltin(OSCMessage &message);
   
   static const char prefixReport[9];// = "/report/";
   static const char prefixPinmode[11];// = "/pinmode/";
@@ -85,18 +87,13 @@ private:
   static const char prefixReset[7];//="/reset"; //TODO: implement
 //  static const byte pwmPinMap[6];
   
+  static WOSC *receiver; // instance running receiveBuiltin()
+  static const OSCMethod builtinMethods[1];
+
   Stream *stream;
-  //////parser variables////////
-  byte oscRxNextOp; //keeps track of current state
-  // space for buffer in RAM
-  char oscRxData[OSC_MAX_RX_MSG_SIZE];
-  
-  byte oscRxMsgSize; // size of incoming msg
-  byte oscRxReadBytes; //number of bytes read
-  byte *oscRxAddr;
-  unsigned long oscRxIntArg1; //int argument of message
-  byte oscRxChecksum;
-  char oscBuffer[MAX_LENGTH]; // holds outgoing WOSC message
+  OSCDispatcher userMethods;
+  SLIPBuffer<OSC_MAX_RX_MSG_SIZE> slip; // framing and receive buffer
+  OSCPacket<OSC_MAX_TX_MSG_SIZE> oscPacket; // holds outgoing WOSC packet
   
   // which values should be reported?
   byte reportAnalog; //bitmask - 0=off, 1=on - default:all off 
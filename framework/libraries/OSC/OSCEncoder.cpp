@@ -0,0 +1,244 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | OSC 1.0 packet encoding.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <string.h>
+#include "OSCEncoder.h"
+
+
+// type tags that have no argument data
+static boolean isEmptyType(char type)
+{
+  return type == 'T' || type == 'F' || type == 'N' || type == 'I';
+}
+
+
+OSCEncoder::OSCEncoder(uint8_t *buffer, size_t size) :
+  _buffer(buffer), _size(size)
+{
+  reset();
+}
+
+
+void OSCEncoder::reset()
+{
+  _length = 0;
+  _types = "";
+  _nesting = 0;
+  _depth = 0;
+  _overflow = false;
+}
+
+
+void OSCEncoder::beginBundle(uint32_t seconds, uint32_t fraction)
+{
+  beginElement();
+  _depth++;
+  writeString("#bundle", 7);
+  writeUInt32(seconds);
+  writeUInt32(fraction);
+}
+
+
+void OSCEncoder::endBundle()
+{
+  if (_depth)
+  {
+    _depth--;
+    endElement();
+  }
+}
+
+
+// typeTags must stay valid until endMessage()
+void OSCEncoder::beginMessage(const char *address, const char *typeTags)
+{
+  size_t count = strlen(typeTags);
+  size_t size = (count + 5) & ~3;  // ',', the tags, NUL and padding
+  uint8_t *p;
+
+  beginElement();
+  writeString(address, strlen(address));
+
+  p = reserve(size);
+  if (p != NULL)
+  {
+    *p++ = ',';
+    memcpy(p, typeTags, count);
+    memset(p + count, 0, size - 1 - count);
+  }
+  _types = typeTags;
+}
+
+
+void OSCEncoder::add(long value)
+{
+  if (nextType('i'))
+    writeUInt32(value);
+}
+
+
+void OSCEncoder::add(float value)
+{
+  union
+  {
+    float f;
+    uint32_t i;
+  } bits;
+
+  bits.f = value;
+  if (nextType('f'))
+    writeUInt32(bits.i);
+}
+
+
+void OSCEncoder::add(const char *value)
+{
+  if (nextType('s'))
+    writeString(value, strlen(value));
+}
+
+
+void OSCEncoder::add(const uint8_t *blob, size_t length)
+{
+  uint8_t *p;
+
+  if (!nextType('b'))
+    return;
+  writeUInt32(length);
+  p = reserve((length + 3) & ~3);
+  if (p != NULL)
+  {
+    memcpy(p, blob, length);
+    memset(p + length, 0, (4 - (length & 3)) & 3);
+  }
+}
+
+
+void OSCEncoder::endMessage()
+{
+  while (isEmptyType(*_types))
+    _types++;
+  // every type tag needs its argument
+  if (*_types)
+    _overflow = true;
+  _types = "";
+  endElement();
+}
+
+
+void OSCEncoder::message(const char *address, long value)
+{
+  beginMessage(address, "i");
+  add(value);
+  endMessage();
+}
+
+
+void OSCEncoder::message(const char *address, float value)
+{
+  beginMessage(address, "f");
+  add(value);
+  endMessage();
+}
+
+
+boolean OSCEncoder::nextType(char type)
+{
+  while (isEmptyType(*_types))
+    _types++;
+  if (*_types != type)
+  {
+    _overflow = true;
+    return false;
+  }
+  _types++;
+  return true;
+}
+
+
+// elements of a bundle are preceded by their size, which is only known
+// once they are complete: leave room for it and patch it in endElement()
+void OSCEncoder::beginElement()
+{
+  if (_depth)
+  {
+    if (_nesting <= OSC_MAX_BUNDLE_DEPTH)
+      _open[_nesting] = _length;
+    else
+      _overflow = true;
+    _nesting++;
+    writeUInt32(0);
+  }
+}
+
+
+void OSCEncoder::endElement()
+{
+  if (_depth && _nesting)
+  {
+    _nesting--;
+    if (!_overflow)
+    {
+      size_t start = _open[_nesting];
+      size_t size = _length - start - 4;
+      _buffer[start] = size >> 24;
+      _buffer[start + 1] = size >> 16;
+      _buffer[start + 2] = size >> 8;
+      _buffer[start + 3] = size;
+    }
+  }
+}
+
+
+uint8_t *OSCEncoder::reserve(size_t size)
+{
+  uint8_t *p;
+
+  if (_overflow || size > _size - _length)
+  {
+    _overflow = true;
+    return NULL;
+  }
+  p = _buffer + _length;
+  _length += size;
+  return p;
+}
+
+
+void OSCEncoder::writeUInt32(uint32_t value)
+{
+  uint8_t *p = reserve(4);
+
+  if (p != NULL)
+  {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+  }
+}
+
+
+// a string, its terminating NUL and padding up to a multiple of 4
+void OSCEncoder::writeString(const char *str, size_t length)
+{
+  uint8_t *p = reserve((length + 4) & ~3);
+
+  if (p != NULL)
+  {
+    memcpy(p, str, length);
+    memset(p + length, 0, 4 - (length & 3));
+  }
+}
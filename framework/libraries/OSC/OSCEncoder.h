@@ -0,0 +1,123 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | OSC 1.0 packet encoding.
+|| |
+|| | OSCEncoder writes messages and bundles straight into a caller
+|| | provided buffer, for example the transmit buffer of the transport,
+|| | so a packet is never built twice.  OSCPacket<N> carries its own
+|| | storage for N bytes.  The type tags of a message are given up front
+|| | and each add() fills in the next argument; 'T', 'F', 'N' and 'I'
+|| | carry no data and need no add().
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @example
+|| | OSCPacket<64> packet;
+|| |
+|| | packet.beginBundle();
+|| | packet.beginMessage("/adc/0", "i");
+|| | packet.add(analogRead(0));
+|| | packet.endMessage();
+|| | packet.beginMessage("/button", digitalRead(8) ? "T" : "F");
+|| | packet.endMessage();
+|| | packet.endBundle();
+|| | if (!packet.overflow())
+|| |   Serial.write(packet.data(), packet.length());
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef OSCENCODER_H
+#define OSCENCODER_H
+
+#include <Wiring.h>
+
+#include "OSCMessage.h"
+
+class OSCEncoder
+{
+  public:
+    OSCEncoder(uint8_t *buffer, size_t size);
+
+    // start over with an empty packet
+    void reset();
+
+    // a bundle may hold messages and other bundles
+    void beginBundle(uint32_t seconds = 0, uint32_t fraction = OSC_IMMEDIATE);
+    void endBundle();
+
+    void beginMessage(const char *address, const char *typeTags = "");
+    void add(long value);
+    void add(int value)
+    {
+      add((long)value);
+    }
+    void add(float value);
+    void add(const char *value);
+    void add(const uint8_t *blob, size_t length);
+    void endMessage();
+
+    // single int or float argument messages in one call
+    void message(const char *address, long value);
+    void message(const char *address, int value)
+    {
+      message(address, (long)value);
+    }
+    void message(const char *address, float value);
+
+    const uint8_t *data() const
+    {
+      return _buffer;
+    }
+    size_t length() const
+    {
+      return _length;
+    }
+    // true if the packet did not fit or the arguments did not match
+    // the type tags since the last reset()
+    boolean overflow() const
+    {
+      return _overflow;
+    }
+
+  private:
+    boolean nextType(char type);
+    void beginElement();
+    void endElement();
+    uint8_t *reserve(size_t size);
+    void writeUInt32(uint32_t value);
+    void writeString(const char *str, size_t length);
+
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _length;
+    const char *_types;      // type tags still waiting for an add()
+    size_t _open[OSC_MAX_BUNDLE_DEPTH + 1];  // size fields to patch
+    uint8_t _nesting;        // entries used in _open
+    uint8_t _depth;          // bundles still open
+    boolean _overflow;
+};
+
+template <size_t N>
+class OSCPacket : public OSCEncoder
+{
+  public:
+    OSCPacket() : OSCEncoder(_storage, N) {}
+
+  private:
+    // the base class points into _storage, so copies are not allowed
+    OSCPacket(const OSCPacket &);
+    OSCPacket &operator = (const OSCPacket &);
+
+    uint8_t _storage[N];
+};
+
+#endif
+// OSCENCODER_H
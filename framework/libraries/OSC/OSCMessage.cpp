@@ -0,0 +1,396 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | OSC 1.0 packet decoding and dispatching.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <string.h>
+#include "OSCMessage.h"
+
+
+static uint32_t readUInt32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint16_t)p[2] << 8) | p[3];
+}
+
+static float readFloat(const uint8_t *p)
+{
+  union
+  {
+    uint32_t i;
+    float f;
+  } value;
+
+  value.i = readUInt32(p);
+  return value.f;
+}
+
+// skip a NUL terminated string and its padding, NULL if it runs past end
+static const uint8_t *skipString(const uint8_t *p, const uint8_t *end)
+{
+  const uint8_t *nul = (const uint8_t *)memchr(p, 0, end - p);
+
+  if (nul == NULL)
+    return NULL;
+  p += ((nul - p) + 4) & ~3;
+  return (p <= end) ? p : NULL;
+}
+
+// skip one argument of the given type, NULL if it is cut short or unknown
+static const uint8_t *skipArgument(char type, const uint8_t *p, const uint8_t *end)
+{
+  uint32_t size;
+
+  switch (type)
+  {
+    case 'i':
+    case 'f':
+    case 'c':
+    case 'r':
+    case 'm':
+      size = 4;
+      break;
+    case 'h':
+    case 't':
+    case 'd':
+      size = 8;
+      break;
+    case 's':
+    case 'S':
+      return skipString(p, end);
+    case 'b':
+      if (end - p < 4)
+        return NULL;
+      size = readUInt32(p);
+      if (size > (uint32_t)(end - p) - 4)
+        return NULL;
+      size = 4 + ((size + 3) & ~3);
+      break;
+    case 'T':
+    case 'F':
+    case 'N':
+    case 'I':
+      size = 0;
+      break;
+    default:
+      return NULL;
+  }
+  if (size > (uint32_t)(end - p))
+    return NULL;
+  return p + size;
+}
+
+
+OSCMessage::OSCMessage() :
+  _address(""), _tags(""), _arguments(NULL), _end(NULL), _count(0),
+  _seconds(0), _fraction(OSC_IMMEDIATE)
+{
+}
+
+
+boolean OSCMessage::parse(const uint8_t *data, size_t length)
+{
+  const uint8_t *end = data + length;
+  const uint8_t *tags;
+  const uint8_t *p;
+  const char *t;
+  uint8_t count = 0;
+
+  _address = _tags = "";
+  _count = 0;
+
+  if (length < 4 || (length & 3) || data[0] != '/')
+    return false;
+
+  tags = skipString(data, end);
+  if (tags == NULL)
+    return false;
+
+  // OSC 1.0 allows the type tags to be left out, take it as no arguments
+  if (tags == end)
+  {
+    _address = (const char *)data;
+    _arguments = _end = end;
+    return true;
+  }
+  if (*tags != ',')
+    return false;
+
+  p = skipString(tags, end);
+  if (p == NULL)
+    return false;
+
+  // make sure every argument is there, so the getters need no checks
+  _arguments = p;
+  for (t = (const char *)tags + 1; *t; t++)
+  {
+    p = skipArgument(*t, p, end);
+    if (p == NULL || count == 255)
+      return false;
+    count++;
+  }
+
+  _address = (const char *)data;
+  _tags = (const char *)tags + 1;
+  _end = end;
+  _count = count;
+  return true;
+}
+
+
+void OSCMessage::setTimeTag(uint32_t seconds, uint32_t fraction)
+{
+  _seconds = seconds;
+  _fraction = fraction;
+}
+
+
+char OSCMessage::getType(uint8_t index) const
+{
+  return (index < _count) ? _tags[index] : '\0';
+}
+
+
+const uint8_t *OSCMessage::argument(uint8_t index) const
+{
+  const uint8_t *p = _arguments;
+  uint8_t i;
+
+  for (i = 0; i < index; i++)
+    p = skipArgument(_tags[i], p, _end);
+  return p;
+}
+
+
+int32_t OSCMessage::getInt(uint8_t index) const
+{
+  switch (getType(index))
+  {
+    case 'i':
+    case 'c':
+      return readUInt32(argument(index));
+    case 'f':
+      return (int32_t)readFloat(argument(index));
+    case 'T':
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+
+float OSCMessage::getFloat(uint8_t index) const
+{
+  switch (getType(index))
+  {
+    case 'f':
+      return readFloat(argument(index));
+    case 'i':
+      return (int32_t)readUInt32(argument(index));
+    case 'T':
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+
+boolean OSCMessage::getBoolean(uint8_t index) const
+{
+  switch (getType(index))
+  {
+    case 'T':
+      return true;
+    case 'i':
+      return readUInt32(argument(index)) != 0;
+    case 'f':
+      return readFloat(argument(index)) != 0;
+    default:
+      return false;
+  }
+}
+
+
+const char *OSCMessage::getString(uint8_t index) const
+{
+  char type = getType(index);
+
+  if (type != 's' && type != 'S')
+    return NULL;
+  return (const char *)argument(index);
+}
+
+
+const uint8_t *OSCMessage::getBlob(uint8_t index, size_t &length) const
+{
+  const uint8_t *p;
+
+  length = 0;
+  if (getType(index) != 'b')
+    return NULL;
+  p = argument(index);
+  length = readUInt32(p);
+  return p + 4;
+}
+
+
+static boolean match(const char *pattern, const char *address, boolean container)
+{
+  for (;;)
+  {
+    // a container address matches whatever is left of the pattern
+    if (container && !*address)
+      return true;
+
+    switch (*pattern)
+    {
+      case '\0':
+        return !*address;
+
+      case '*':
+        // any run of characters within one part of the address
+        while (*pattern == '*')
+          pattern++;
+        for (;;)
+        {
+          if (match(pattern, address, container))
+            return true;
+          if (!*address || *address == '/')
+            return false;
+          address++;
+        }
+
+      case '?':
+        if (!*address || *address == '/')
+          return false;
+        break;
+
+      case '[':
+      {
+        boolean negate = (pattern[1] == '!');
+        boolean found = false;
+
+        if (!*address || *address == '/')
+          return false;
+        pattern += negate ? 2 : 1;
+        while (*pattern && *pattern != ']')
+        {
+          char low = *pattern++;
+          char high = low;
+          if (*pattern == '-' && pattern[1] && pattern[1] != ']')
+          {
+            high = pattern[1];
+            pattern += 2;
+          }
+          if (*address >= low && *address <= high)
+            found = true;
+        }
+        if (*pattern != ']' || found == negate)
+          return false;
+        break;
+      }
+
+      case '{':
+      {
+        const char *close = strchr(pattern, '}');
+        const char *alternative = pattern + 1;
+
+        if (close == NULL)
+          return false;
+        for (;;)
+        {
+          const char *end = alternative;
+          while (end != close && *end != ',')
+            end++;
+          if (strncmp(alternative, address, end - alternative) == 0 &&
+              match(close + 1, address + (end - alternative), container))
+            return true;
+          if (end == close)
+            return false;
+          alternative = end + 1;
+        }
+      }
+
+      default:
+        if (*pattern != *address)
+          return false;
+        break;
+    }
+    pattern++;
+    address++;
+  }
+}
+
+boolean oscMatch(const char *pattern, const char *address, boolean prefix)
+{
+  size_t length = strlen(address);
+
+  return match(pattern, address, prefix && length && address[length - 1] == '/');
+}
+
+
+OSCDispatcher::OSCDispatcher(const OSCMethod *methods, uint8_t count) :
+  _methods(methods), _count(count)
+{
+}
+
+
+uint8_t OSCDispatcher::dispatch(const uint8_t *packet, size_t length)
+{
+  return dispatch(packet, length, 0, OSC_IMMEDIATE, 0);
+}
+
+
+uint8_t OSCDispatcher::dispatch(const uint8_t *packet, size_t length, uint32_t seconds, uint32_t fraction, uint8_t depth)
+{
+  uint8_t called = 0;
+  uint8_t i;
+
+  if (length >= 16 && memcmp(packet, "#bundle", 8) == 0)
+  {
+    const uint8_t *end = packet + length;
+    const uint8_t *p = packet + 16;
+
+    if (depth >= OSC_MAX_BUNDLE_DEPTH)
+      return 0;
+    seconds = readUInt32(packet + 8);
+    fraction = readUInt32(packet + 12);
+
+    // each element is a size followed by a message or another bundle
+    while (end - p >= 4)
+    {
+      uint32_t size = readUInt32(p);
+      p += 4;
+      if (size > (uint32_t)(end - p))
+        break;
+      called += dispatch(p, size, seconds, fraction, depth + 1);
+      p += size;
+    }
+    return called;
+  }
+
+  OSCMessage message;
+
+  if (!message.parse(packet, length))
+    return 0;
+  message.setTimeTag(seconds, fraction);
+
+  for (i = 0; i < _count; i++)
+  {
+    if (oscMatch(message.address(), _methods[i].address, true))
+    {
+      (*_methods[i].callback)(message);
+      called++;
+    }
+  }
+  return called;
+}
@@ -0,0 +1,139 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | OSC 1.0 packet decoding and dispatching.
+|| |
+|| | OSCMessage reads a message in place: the address, the type tags,
+|| | strings and blobs are handed out as pointers into the received
+|| | packet, nothing is copied.  OSCDispatcher walks a packet (a message
+|| | or a bundle, nested bundles included) and calls every method of a
+|| | table whose address matches the address pattern of a message.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @example
+|| | void setLed(OSCMessage &message)
+|| | {
+|| |   digitalWrite(WLED, message.getBoolean(0));
+|| | }
+|| |
+|| | const OSCMethod methods[] = {
+|| |   { "/led", setLed },
+|| |   { "/servo/", setServo }    // container: /servo/1, /servo/2, ...
+|| | };
+|| | OSCDispatcher dispatcher(methods, 2);
+|| |
+|| | dispatcher.dispatch(packet, length);
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef OSCMESSAGE_H
+#define OSCMESSAGE_H
+
+#include <Wiring.h>
+
+// time tag meaning "immediately"
+#define OSC_IMMEDIATE 1
+
+// bundles nested deeper than this are ignored
+#ifndef OSC_MAX_BUNDLE_DEPTH
+#define OSC_MAX_BUNDLE_DEPTH 4
+#endif
+
+class OSCMessage
+{
+  public:
+    OSCMessage();
+
+    // check a message and point into it, data must stay valid (and
+    // unchanged) while the message is used
+    boolean parse(const uint8_t *data, size_t length);
+
+    const char *address() const
+    {
+      return _address;
+    }
+    // type tags without the leading ','
+    const char *typeTags() const
+    {
+      return _tags;
+    }
+    uint8_t size() const
+    {
+      return _count;
+    }
+    char getType(uint8_t index) const;
+
+    // time tag of the enclosing bundle, OSC_IMMEDIATE if there is none
+    uint32_t timeTagSeconds() const
+    {
+      return _seconds;
+    }
+    uint32_t timeTagFraction() const
+    {
+      return _fraction;
+    }
+    void setTimeTag(uint32_t seconds, uint32_t fraction);
+
+    // typed access, the value is converted where it makes sense
+    // ('i' <-> 'f', 'T'/'F' -> 1/0) and 0 if it does not
+    int32_t getInt(uint8_t index) const;
+    float getFloat(uint8_t index) const;
+    boolean getBoolean(uint8_t index) const;
+    // pointers into the packet, NULL if the argument has another type
+    const char *getString(uint8_t index) const;
+    const uint8_t *getBlob(uint8_t index, size_t &length) const;
+
+  private:
+    const uint8_t *argument(uint8_t index) const;
+
+    const char *_address;
+    const char *_tags;
+    const uint8_t *_arguments;
+    const uint8_t *_end;
+    uint8_t _count;
+    uint32_t _seconds;
+    uint32_t _fraction;
+};
+
+
+// Match an OSC address pattern (?, *, [a-z], [!a-z], {foo,bar}) against
+// an address.  If prefix is true, an address ending in '/' is a container
+// that matches every pattern below it, so "/out/" matches "/out/13".
+boolean oscMatch(const char *pattern, const char *address, boolean prefix = false);
+
+
+typedef void (*OSCCallback)(OSCMessage &message);
+
+struct OSCMethod
+{
+  const char *address;  // ending in '/' to catch everything below it
+  OSCCallback callback;
+};
+
+class OSCDispatcher
+{
+  public:
+    OSCDispatcher(const OSCMethod *methods, uint8_t count);
+
+    // decode a whole packet and call the matching methods, bundles are
+    // delivered right away with their time tag set in the message.
+    // Returns the number of methods called.
+    uint8_t dispatch(const uint8_t *packet, size_t length);
+
+  private:
+    uint8_t dispatch(const uint8_t *packet, size_t length, uint32_t seconds, uint32_t fraction, uint8_t depth);
+
+    const OSCMethod *_methods;
+    uint8_t _count;
+};
+
+#endif
+// OSCMESSAGE_H
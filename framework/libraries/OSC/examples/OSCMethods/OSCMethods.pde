@@ -0,0 +1,63 @@
+/**
+ * OSC Methods
+ *
+ * Handles its own OSC addresses from a table of methods and
+ * reports two analog inputs in one bundle.  Hosts can set the
+ * LED and several servo positions with a single packet.
+ */
+
+#include <OSC.h>
+#include <Servo.h>
+
+Servo servos[2];
+
+void setLed(OSCMessage &message)
+{
+  digitalWrite(WLED, message.getBoolean(0));
+}
+
+// "/servo/0 i 90" or, with a pattern, "/servo/* i 90" for both
+void setServo(OSCMessage &message)
+{
+  const char *address = message.address();
+  for (int i = 0; i < 2; i++)
+  {
+    char name[] = "/servo/0";
+    name[7] += i;
+    if (oscMatch(address, name))
+      servos[i].write(message.getInt(0));
+  }
+}
+
+const OSCMethod methods[] = {
+  { "/led", setLed },
+  { "/servo/", setServo }
+};
+
+OSCPacket<48> packet;
+unsigned long lastReport = 0;
+
+void setup()
+{
+  pinMode(WLED, OUTPUT);
+  servos[0].attach(4);
+  servos[1].attach(5);
+  OSC.begin();
+  OSC.attach(methods, 2);
+}
+
+void loop()
+{
+  OSC.transmit();
+
+  if (millis() - lastReport >= 50)
+  {
+    lastReport = millis();
+    packet.reset();
+    packet.beginBundle();
+    packet.message("/adc/0", analogRead(0));
+    packet.message("/adc/1", analogRead(1));
+    packet.endBundle();
+    OSC.send(packet);
+  }
+}
@@ -0,0 +1,164 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Compact binary telemetry records.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#include <string.h>
+#include "Telemetry.h"
+
+
+static uint8_t *putVarint(uint8_t *p, uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    *p++ = value | 0x80;
+    value >>= 7;
+  }
+  *p++ = value;
+  return p;
+}
+
+// small negative numbers become small positive ones: 0, -1, 1, -2 ...
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+
+Telemetry::Telemetry(Print &output, const TelemetryField *fields, uint8_t count,
+                     long *previous, uint8_t *record, uint8_t keyInterval) :
+  _output(&output), _fields(fields), _count(count), _previous(previous),
+  _record(record), _keyInterval(keyInterval ? keyInterval : 1),
+  _sequence(0)
+{
+  memset(_previous, 0, count * sizeof(long));
+  _sinceKey = _keyInterval;
+  beginRecord();
+}
+
+
+void Telemetry::begin()
+{
+  // an END first flushes whatever the receiver has collected so far
+  _output->write((uint8_t)SLIP_END);
+  sendSchema();
+}
+
+
+void Telemetry::sendSchema()
+{
+  uint8_t header[4] = { 'S', TELEMETRY_VERSION, _count, 0 };
+  uint8_t sum = 0;
+  uint8_t i;
+
+  // rarely sent, so it goes out piece by piece instead of through _record
+  writeChecked(header, 3, sum);
+  for (i = 0; i < _count; i++)
+  {
+    const TelemetryField &field = _fields[i];
+    header[0] = field.type;
+    header[1] = field.decimals;
+    writeChecked(header, 2, sum);
+    writeChecked((const uint8_t *)field.name, strlen(field.name) + 1, sum);
+  }
+  header[0] = -sum;
+  SLIP::writeEscaped(*_output, header, 1);
+  _output->write((uint8_t)SLIP_END);
+
+  // the decoder needs full values again
+  key();
+}
+
+
+void Telemetry::key()
+{
+  _sinceKey = _keyInterval;
+  // a record with no values yet can still become one
+  if (_field == 0)
+    beginRecord();
+}
+
+
+void Telemetry::beginRecord()
+{
+  _key = (_sinceKey >= _keyInterval);
+  _next = _record;
+  *_next++ = _key ? 'K' : 'D';
+  if (_key)
+    _next = putVarint(_next, _sequence);
+  else
+    *_next++ = _sequence;
+  _field = 0;
+}
+
+
+void Telemetry::add(long value)
+{
+  uint8_t type;
+  uint32_t encoded;
+
+  if (_field >= _count)
+    return;
+
+  type = _fields[_field].type;
+  if (!_key && (type & TELEMETRY_DELTA))
+    encoded = zigzag((uint32_t)value - (uint32_t)_previous[_field]);
+  else if (type & TELEMETRY_UINT)
+    encoded = value;
+  else
+    encoded = zigzag(value);
+  _previous[_field] = value;
+  _next = putVarint(_next, encoded);
+  _field++;
+}
+
+
+void Telemetry::endRecord()
+{
+  uint8_t sum = 0;
+  uint8_t *p;
+
+  while (_field < _count)
+    add(_previous[_field]);
+
+  for (p = _record; p != _next; p++)
+    sum += *p;
+  *_next++ = -sum;
+  SLIP::writeEscaped(*_output, _record, _next - _record);
+  _output->write((uint8_t)SLIP_END);
+
+  _sequence++;
+  _sinceKey = _key ? 1 : _sinceKey + 1;
+  beginRecord();
+}
+
+
+void Telemetry::record(const long *values)
+{
+  uint8_t i;
+
+  beginRecord();
+  for (i = 0; i < _count; i++)
+    add(values[i]);
+  endRecord();
+}
+
+
+void Telemetry::writeChecked(const uint8_t *data, size_t length, uint8_t &sum)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    sum += data[i];
+  SLIP::writeEscaped(*_output, data, length);
+}
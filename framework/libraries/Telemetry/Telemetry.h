@@ -0,0 +1,151 @@
+/* $Id$
+||
+|| @author         Wiring Project
+|| @url            http://wiring.org.co/
+||
+|| @description
+|| | Compact binary telemetry records.
+|| |
+|| | The fields of a record are declared once, as an array of
+|| | TelemetryField.  Values are integers; the decoder shows them with
+|| | the declared number of decimals, so 2345 with 2 decimals is 23.45.
+|| | Each record is sent in bulk writes as variable length integers:
+|| | small values take one byte instead of the five or more of text.
+|| | Fields marked TELEMETRY_DELTA are sent as the difference to the
+|| | previous record, which keeps slowly changing values and time stamps
+|| | at one byte too.
+|| |
+|| | Every keyInterval records a key record carries all values in full,
+|| | so a receiver that starts late or loses a record is back in step at
+|| | the next key record.  Records carry a sequence number to reveal
+|| | losses, and a checksum.  The schema itself is sent by begin() and
+|| | sendSchema(), which makes the stream self-describing: the
+|| | TelemetryDecoder tool in this library turns it into CSV.
+|| |
+|| | Output goes to any Print: HardwareSerial, NewSoftSerial, a file.
+|| |
+|| | Stream format: records are SLIP framed (each ends with SLIP_END,
+|| | SLIP_END and SLIP_ESC inside are escaped) and hold a type byte,
+|| | the contents and a checksum byte that makes all bytes add up to 0.
+|| | 'S' schema:  version, field count, per field type, decimals, name, 0
+|| | 'K' key:     sequence number, values
+|| | 'D' delta:   low byte of the sequence number, values
+|| | Numbers are LEB128 varints, signed ones zigzag encoded first.
+|| |
+|| | Wiring Cross-platform Library
+|| #
+||
+|| @example
+|| | const TelemetryField fields[] = {
+|| |   { "time", TELEMETRY_UINT | TELEMETRY_DELTA, 3 },
+|| |   { "temperature", TELEMETRY_INT, 2 }
+|| | };
+|| | TelemetryLog<2> telemetry(Serial, fields);
+|| |
+|| | telemetry.begin();
+|| | ...
+|| | telemetry.beginRecord();
+|| | telemetry.add(millis());
+|| | telemetry.add(temperature);
+|| | telemetry.endRecord();
+|| #
+||
+|| @license Please see cores/Common/License.txt.
+||
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Wiring.h>
+#include <SLIP.h>
+
+#define TELEMETRY_VERSION     1
+
+// field types
+#define TELEMETRY_INT         0x00    // signed
+#define TELEMETRY_UINT        0x01    // unsigned
+#define TELEMETRY_DELTA       0x02    // sent as the change since the last record
+
+// largest encoded record for n fields: type, sequence number, values
+// and checksum
+#define TELEMETRY_RECORD_SIZE(n) (7 + 5 * (n))
+
+struct TelemetryField
+{
+  const char *name;
+  uint8_t type;
+  uint8_t decimals;
+};
+
+// previous holds count values and record TELEMETRY_RECORD_SIZE(count)
+// bytes, TelemetryLog<N> brings both along
+class Telemetry
+{
+  public:
+    Telemetry(Print &output, const TelemetryField *fields, uint8_t count,
+              long *previous, uint8_t *record, uint8_t keyInterval = 16);
+
+    // start the stream with the schema
+    void begin();
+    void sendSchema();
+    // make the next record a key record
+    void key();
+
+    // values are added in the order of the fields, the ones left out
+    // repeat their previous value
+    void beginRecord();
+    void add(long value);
+    void add(unsigned long value)
+    {
+      add((long)value);
+    }
+    void add(int value)
+    {
+      add((long)value);
+    }
+    void endRecord();
+    // a whole record at once
+    void record(const long *values);
+
+    // number of the next record
+    unsigned long sequence() const
+    {
+      return _sequence;
+    }
+
+  private:
+    void writeChecked(const uint8_t *data, size_t length, uint8_t &sum);
+
+    Print *_output;
+    const TelemetryField *_fields;
+    uint8_t _count;
+    long *_previous;
+    uint8_t *_record;
+    uint8_t *_next;         // where the next value goes in _record
+    uint8_t _field;         // index of the next value
+    uint8_t _keyInterval;
+    uint8_t _sinceKey;      // records since the last key record
+    boolean _key;           // the record being built is a key record
+    unsigned long _sequence;
+};
+
+template <uint8_t N>
+class TelemetryLog : public Telemetry
+{
+  public:
+    // the fields array must have N entries
+    TelemetryLog(Print &output, const TelemetryField (&fields)[N], uint8_t keyInterval = 16) :
+      Telemetry(output, fields, N, _previous, _storage, keyInterval) {}
+
+  private:
+    // the base class points into _previous and _storage, so copies are not allowed
+    TelemetryLog(const TelemetryLog &);
+    TelemetryLog &operator = (const TelemetryLog &);
+
+    long _previous[N];
+    uint8_t _storage[TELEMETRY_RECORD_SIZE(N)];
+};
+
+#endif
+// TELEMETRY_H
@@ -0,0 +1,45 @@
+/**
+ * SensorLog
+ *
+ * Streams two analog inputs and the time as compact binary telemetry
+ * records, a hundred per second.  Decode the stream on the computer
+ * with the TelemetryDecoder tool in the tools folder of this library:
+ *
+ *   java TelemetryDecoder < capture.bin > sensors.csv
+ */
+
+#include <Telemetry.h>
+
+// declared once: name, type and the decimals the decoder shows
+const TelemetryField fields[] = {
+  { "time", TELEMETRY_UINT | TELEMETRY_DELTA, 3 },   // milliseconds, shown as seconds
+  { "light", TELEMETRY_INT | TELEMETRY_DELTA, 0 },
+  { "millivolts", TELEMETRY_INT, 0 }
+};
+
+TelemetryLog<3> telemetry(Serial, fields);
+
+unsigned long next = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  telemetry.begin();
+}
+
+void loop()
+{
+  if ((long)(millis() - next) >= 0)
+  {
+    next += 10;
+    telemetry.beginRecord();
+    telemetry.add(millis());
+    telemetry.add(analogRead(0));
+    telemetry.add(analogRead(1) * 5000L / 1023);
+    telemetry.endRecord();
+
+    // let a decoder started late learn the field names
+    if ((telemetry.sequence() % 1000) == 0)
+      telemetry.sendSchema();
+  }
+}
@@ -0,0 +1,257 @@
+/* -*- mode: java; c-basic-offset: 2; indent-tabs-mode: nil -*- */
+
+/*
+  Part of the Wiring project - http://wiring.org.co
+
+  Turns the record stream of the Telemetry library into CSV.
+
+  Usage:
+    javac TelemetryDecoder.java
+    java TelemetryDecoder [capture file] > telemetry.csv
+
+  Without a file the stream is read from standard input, so a serial
+  port set to raw mode can be piped in directly, for example on Linux:
+    stty -F /dev/ttyUSB0 115200 raw && java TelemetryDecoder < /dev/ttyUSB0
+
+  The first column is the sequence number of the record, gaps in it
+  show lost records.  Records that can not be decoded are counted on
+  standard error.
+
+  Please see cores/Common/License.txt.
+*/
+
+import java.io.BufferedInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.PrintStream;
+import java.math.BigDecimal;
+
+
+public class TelemetryDecoder {
+  static final int SLIP_END = 0xC0;
+  static final int SLIP_ESC = 0xDB;
+  static final int SLIP_ESC_END = 0xDC;
+  static final int SLIP_ESC_ESC = 0xDD;
+
+  static final int VERSION = 1;
+  static final int TYPE_UINT = 0x01;
+  static final int TYPE_DELTA = 0x02;
+
+  PrintStream out;
+
+  // schema
+  String[] names;
+  int[] types;
+  int[] decimals;
+
+  // state of the delta chain, valid after a key record
+  int[] values;
+  long sequence;
+  boolean synced;
+
+  int dropped;
+
+
+  public TelemetryDecoder(PrintStream out) {
+    this.out = out;
+  }
+
+
+  /** Read a whole stream, one SLIP frame at a time. */
+  public void decode(InputStream in) throws IOException {
+    ByteArrayOutputStream frame = new ByteArrayOutputStream();
+    boolean escape = false;
+    int c;
+
+    while ((c = in.read()) != -1) {
+      if (c == SLIP_END) {
+        if (frame.size() > 0) {
+          record(frame.toByteArray());
+          frame.reset();
+        }
+        escape = false;
+      } else if (c == SLIP_ESC) {
+        escape = true;
+      } else {
+        if (escape) {
+          if (c == SLIP_ESC_END) c = SLIP_END;
+          else if (c == SLIP_ESC_ESC) c = SLIP_ESC;
+          escape = false;
+        }
+        frame.write(c);
+      }
+    }
+    out.flush();
+  }
+
+
+  void record(byte[] data) {
+    int sum = 0;
+    for (int i = 0; i < data.length; i++) {
+      sum += data[i];
+    }
+    if (data.length < 2 || (sum & 0xFF) != 0) {
+      drop();
+      return;
+    }
+
+    Reader r = new Reader(data, data.length - 1);
+    try {
+      switch (r.next()) {
+      case 'S':
+        schema(r);
+        break;
+      case 'K':
+        key(r);
+        break;
+      case 'D':
+        delta(r);
+        break;
+      default:
+        drop();
+      }
+    } catch (ArrayIndexOutOfBoundsException e) {
+      // cut short
+      drop();
+    }
+  }
+
+
+  void schema(Reader r) {
+    if (r.next() != VERSION) {
+      drop();
+      return;
+    }
+    int count = r.next();
+    names = new String[count];
+    types = new int[count];
+    decimals = new int[count];
+    values = new int[count];
+    for (int i = 0; i < count; i++) {
+      types[i] = r.next();
+      decimals[i] = r.next();
+      names[i] = r.string();
+    }
+    synced = false;
+
+    StringBuffer header = new StringBuffer("sequence");
+    for (int i = 0; i < count; i++) {
+      header.append(',').append(names[i]);
+    }
+    out.println(header);
+  }
+
+
+  void key(Reader r) {
+    if (names == null) {
+      // no schema seen yet
+      drop();
+      return;
+    }
+    sequence = r.varint() & 0xFFFFFFFFL;
+    for (int i = 0; i < values.length; i++) {
+      values[i] = ((types[i] & TYPE_UINT) != 0) ? r.varint() : unzigzag(r.varint());
+    }
+    synced = true;
+    print();
+  }
+
+
+  void delta(Reader r) {
+    // a lost record breaks the delta chain until the next key record
+    if (!synced || r.next() != ((sequence + 1) & 0xFF)) {
+      synced = false;
+      drop();
+      return;
+    }
+    sequence = (sequence + 1) & 0xFFFFFFFFL;
+    for (int i = 0; i < values.length; i++) {
+      if ((types[i] & TYPE_DELTA) != 0) {
+        values[i] += unzigzag(r.varint());
+      } else if ((types[i] & TYPE_UINT) != 0) {
+        values[i] = r.varint();
+      } else {
+        values[i] = unzigzag(r.varint());
+      }
+    }
+    print();
+  }
+
+
+  void print() {
+    StringBuffer line = new StringBuffer();
+    line.append(sequence);
+    for (int i = 0; i < values.length; i++) {
+      long value = values[i];
+      if ((types[i] & TYPE_UINT) != 0) {
+        value &= 0xFFFFFFFFL;
+      }
+      line.append(',').append(BigDecimal.valueOf(value, decimals[i]).toPlainString());
+    }
+    out.println(line);
+  }
+
+
+  void drop() {
+    dropped++;
+  }
+
+
+  static int unzigzag(int value) {
+    return (value >>> 1) ^ -(value & 1);
+  }
+
+
+  /** Reads bytes, varints and strings off a record. */
+  static class Reader {
+    byte[] data;
+    int position;
+    int end;
+
+    Reader(byte[] data, int end) {
+      this.data = data;
+      this.end = end;
+    }
+
+    int next() {
+      if (position >= end) {
+        throw new ArrayIndexOutOfBoundsException(position);
+      }
+      return data[position++] & 0xFF;
+    }
+
+    int varint() {
+      int value = 0;
+      int shift = 0;
+      int c;
+      do {
+        c = next();
+        value |= (c & 0x7F) << shift;
+        shift += 7;
+      } while ((c & 0x80) != 0);
+      return value;
+    }
+
+    String string() {
+      StringBuffer s = new StringBuffer();
+      int c;
+      while ((c = next()) != 0) {
+        s.append((char) c);
+      }
+      return s.toString();
+    }
+  }
+
+
+  public static void main(String[] args) throws IOException {
+    InputStream in = (args.length > 0) ? new FileInputStream(args[0]) : System.in;
+    TelemetryDecoder decoder = new TelemetryDecoder(System.out);
+
+    decoder.decode(new BufferedInputStream(in));
+    if (decoder.dropped > 0) {
+      System.err.println(decoder.dropped + " records could not be decoded");
+    }
+  }
+}